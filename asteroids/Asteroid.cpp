@@ -1,33 +1,22 @@
 #include "Asteroid.h"
 #include "Global.h"
 
-Asteroid::Asteroid() : Entity(sf::Vector2f(0, 0), 0.f) {
-    radius = 30.f; // Random size between 20 and 60
+Asteroid::Asteroid() : position(0, 0), angle(0.f), variant(0) {
     spawnOnEdge();
 
     velocity = sf::Vector2f(Global::randomFloat(-1.f, 1.f), Global::randomFloat(-1.f, 1.f)); // Random velocity
 
-    // Adjusting the shape points based on the size
-    shape.setPointCount(8); // 8-sided asteroid
-
-
-    for (int i = 0; i < 8; i++) {
-        float angle = (i / 8.f) * 360.f;
-        float rad = angle * (M_PI / 180.f);
-        shape.setPoint(i, sf::Vector2f(cos(rad) * radius, sin(rad) * radius)); // Use randomRadius to set the point
-    }
-
-    shape.setFillColor(sf::Color::Transparent); // Make it look like an outline
-    shape.setOutlineColor(sf::Color::White);
-    shape.setOutlineThickness(2);
+    setRadius(30.f);
 }
 
 // Asteroid copy constructor
 Asteroid::Asteroid(const Asteroid& asteroid)
-    : Entity(asteroid),           // Copy the base class (Entity) data
-    shape(asteroid.shape),       // Copy the shape (for rendering)
-    velocity(asteroid.velocity), // Copy the velocity
-    radius(asteroid.radius)          // Copy the size
+    : velocity(asteroid.velocity), // Copy the velocity
+    position(asteroid.position),  // Copy the position
+    angle(asteroid.angle),        // Copy the angle
+    radius(asteroid.radius),      // Copy the size
+    variant(asteroid.variant),    // Copy the shape
+    shape(asteroid.shape)
 {
 }
 
@@ -40,22 +29,9 @@ void Asteroid::update(float delta_time) {
 
 }
 
-void Asteroid::render(sf::RenderWindow& window)
-{    
-
-    window.draw(shape, sf::Transform().translate(position).rotate(angle));
-    //drawWithWraparound(window, shape, position, angle);
-}
-
 void Asteroid::setRadius(float newRadius) {
     radius = newRadius;  // Update the class member radius
-
-    // Adjust the shape to reflect the new size
-    for (int i = 0; i < 8; i++) {
-        float angle = (i / 8.f) * 360.f;
-        float rad = angle * (M_PI / 180.f);
-        shape.setPoint(i, sf::Vector2f(cos(rad) * radius, sin(rad) * radius)); // Use randomRadius to set the point
-    }
+    shape = &AsteroidShapes::get(variant, radius);
 }
 
 
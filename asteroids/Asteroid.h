@@ -1,21 +1,28 @@
 #pragma once
 
 #include "Entity.h"
+#include "AsteroidShapes.h"
 
 // ASTEROIDS VARIABLES
 constexpr float ASTEROID_SPEED = 80.f;
 constexpr float ASTEROID_SPIN = 50.f;
 constexpr float ASTEROID_SPAWN_TIME = 3.f;
 
-class Asteroid : public Entity {
+// Held by value in GameLogic::asteroids, no virtual functions
+class Asteroid {
     private:
 
         sf::Vector2f velocity;
 
 
     public:
-        sf::ConvexShape shape;
+        sf::Vector2f position;
+        float angle;
         float radius;
+        int variant;                            // AsteroidShapes::variant of the entity id
+
+        // Outline drawn by BatchRenderer, relative to position. Shared, picked by setRadius
+        const AsteroidShapes::Outline* shape;
 
         // Asteroid constructor
         Asteroid();
@@ -23,10 +30,7 @@ class Asteroid : public Entity {
         Asteroid(const Asteroid& asteroid);
 
         // Update Asteroid
-        void update(float delta_time) override;
-
-        // Draw Asteroid
-        void render(sf::RenderWindow& window) override;
+        void update(float delta_time);
 
         void setRadius(float newRadius);
 
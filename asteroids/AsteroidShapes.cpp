@@ -0,0 +1,183 @@
+#include "AsteroidShapes.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::array<std::array<AsteroidShapes::Outline, AsteroidShapes::RADIUS_BUCKETS>, AsteroidShapes::VARIANTS> AsteroidShapes::outlines{};
+std::array<std::array<bool, AsteroidShapes::RADIUS_BUCKETS>, AsteroidShapes::VARIANTS> AsteroidShapes::built{};
+
+namespace {
+    constexpr double PI = 3.14159265358979323846;
+
+    // std::sin, std::cos and std::sqrt are not constexpr, these are exact to float precision
+    // for the angles and lengths used below
+    constexpr double sine(double x) {
+        while (x > PI) x -= 2 * PI;
+        while (x < -PI) x += 2 * PI;
+        double term = x, sum = x;
+        for (int n = 1; n < 12; n++) {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double cosine(double x) {
+        return sine(x + PI / 2);
+    }
+
+    constexpr double squareRoot(double x) {
+        double r = x > 1 ? x : 1;
+        for (int i = 0; i < 40; i++) {
+            r = (r + x / r) / 2;
+        }
+        return r;
+    }
+
+    // Distance of each point from the center, relative to the radius. At most 1 so the outline
+    // stays inside the collision circle the server uses, the first row is the regular polygon
+    constexpr float JAGGEDNESS[AsteroidShapes::VARIANTS][ASTEROID_POINTS] = {
+        { 1.00f, 1.00f, 1.00f, 1.00f, 1.00f, 1.00f, 1.00f, 1.00f },
+        { 1.00f, 0.80f, 0.95f, 1.00f, 0.78f, 1.00f, 0.90f, 0.85f },
+        { 0.90f, 1.00f, 0.75f, 0.95f, 1.00f, 0.82f, 1.00f, 0.92f },
+        { 1.00f, 0.92f, 1.00f, 0.76f, 0.96f, 0.88f, 0.80f, 1.00f },
+    };
+
+    struct UnitPoint {
+        float x, y;         // point of the polygon at radius 1
+        float mx, my;       // outline offset per unit of thickness
+    };
+
+    using UnitPolygon = std::array<UnitPoint, ASTEROID_POINTS>;
+
+    constexpr UnitPolygon makeUnitPolygon(int variant) {
+        UnitPolygon polygon{};
+        for (int i = 0; i < ASTEROID_POINTS; i++) {
+            const double rad = 2 * PI * i / ASTEROID_POINTS;
+            polygon[i].x = (float)(cosine(rad) * JAGGEDNESS[variant][i]);
+            polygon[i].y = (float)(sine(rad) * JAGGEDNESS[variant][i]);
+        }
+
+        // Same miter as sf::Shape outlines: along the sum of both edge normals, long enough for
+        // both edges to be the outline thickness. Points go around by increasing angle, so
+        // (dy, -dx) of an edge points out
+        for (int i = 0; i < ASTEROID_POINTS; i++) {
+            const UnitPoint& p0 = polygon[(i + ASTEROID_POINTS - 1) % ASTEROID_POINTS];
+            const UnitPoint& p1 = polygon[i];
+            const UnitPoint& p2 = polygon[(i + 1) % ASTEROID_POINTS];
+
+            double n1x = p1.y - p0.y, n1y = p0.x - p1.x;
+            double n2x = p2.y - p1.y, n2y = p1.x - p2.x;
+            const double l1 = squareRoot(n1x * n1x + n1y * n1y);
+            const double l2 = squareRoot(n2x * n2x + n2y * n2y);
+            n1x /= l1; n1y /= l1;
+            n2x /= l2; n2y /= l2;
+
+            const double factor = 1 + n1x * n2x + n1y * n2y;
+            polygon[i].mx = (float)((n1x + n2x) / factor);
+            polygon[i].my = (float)((n1y + n2y) / factor);
+        }
+        return polygon;
+    }
+
+    constexpr std::array<UnitPolygon, AsteroidShapes::VARIANTS> makeUnitPolygons() {
+        std::array<UnitPolygon, AsteroidShapes::VARIANTS> polygons{};
+        for (int v = 0; v < AsteroidShapes::VARIANTS; v++) {
+            polygons[v] = makeUnitPolygon(v);
+        }
+        return polygons;
+    }
+
+    constexpr std::array<UnitPolygon, AsteroidShapes::VARIANTS> UNIT_POLYGONS = makeUnitPolygons();
+
+    constexpr bool approximately(float a, double b) {
+        return a - b < 1e-6 && b - a < 1e-6;
+    }
+
+    // Regular octagon: the point at 90 degrees is (0, 1), and corners move out by 1 / cos(22.5)
+    static_assert(ASTEROID_POINTS == 8, "checks below assume an octagon");
+    static_assert(approximately(UNIT_POLYGONS[0][2].x, 0) && approximately(UNIT_POLYGONS[0][2].y, 1), "unit polygon angles");
+    static_assert(approximately(UNIT_POLYGONS[0][2].my, 1.0823922002923940), "outline miter length");
+    static_assert(approximately(UNIT_POLYGONS[0][1].mx, UNIT_POLYGONS[0][1].x * 1.0823922002923940), "outline miter direction");
+}
+
+int AsteroidShapes::variant(uint32_t id) {
+    if (!JAGGED) {
+        return 0;
+    }
+    // Fibonacci hash, bits 24 and up of the product depend on the slot and the generation
+    return (int)((id * 2654435769u) >> 24) % VARIANTS;
+}
+
+const AsteroidShapes::Outline& AsteroidShapes::get(int variant, float radius) {
+    const int bucket = std::max(0, std::min(RADIUS_BUCKETS - 1, (int)std::lround(radius)));
+    Outline& outline = outlines[variant][bucket];
+
+    if (!built[variant][bucket]) {
+        const UnitPolygon& unit = UNIT_POLYGONS[variant];
+        const float r = (float)bucket;
+
+        // Quad between the points and the outline, for every edge
+        for (int i = 0; i < ASTEROID_POINTS; i++) {
+            const UnitPoint& a = unit[i];
+            const UnitPoint& b = unit[(i + 1) % ASTEROID_POINTS];
+            const sf::Vector2f in0(a.x * r, a.y * r), out0(a.x * r + a.mx * ASTEROID_OUTLINE, a.y * r + a.my * ASTEROID_OUTLINE);
+            const sf::Vector2f in1(b.x * r, b.y * r), out1(b.x * r + b.mx * ASTEROID_OUTLINE, b.y * r + b.my * ASTEROID_OUTLINE);
+
+            sf::Vector2f* v = &outline[i * 6];
+            v[0] = in0;
+            v[1] = out0;
+            v[2] = in1;
+            v[3] = in1;
+            v[4] = out0;
+            v[5] = out1;
+        }
+        built[variant][bucket] = true;
+    }
+    return outline;
+}
+
+bool AsteroidShapes::selfCheck(std::ostream& os) {
+    os << "asteroid shapes self check" << std::endl;
+
+    bool ok = true;
+    const auto check = [&](const char* name, bool passed) {
+        os << "\t" << name << (passed ? ": ok" : ": FAILED") << std::endl;
+        ok = ok && passed;
+    };
+
+    check("one outline per variant and whole radius",
+        &get(0, 30.f) == &get(0, 30.2f) && &get(0, 30.f) != &get(0, 31.f) && &get(0, 30.f) != &get(1, 30.f));
+
+    // Ids as the server makes them, slot and generation both changing
+    int counts[VARIANTS] = {};
+    for (uint32_t id = 0; id < 4000; id++) {
+        counts[variant(id | id << 16)]++;
+    }
+    bool spread = true;
+    for (int v = 0; v < VARIANTS; v++) {
+        spread = spread && (!JAGGED || counts[v] > 4000 / VARIANTS / 2);
+    }
+    check("variants spread over ids", spread);
+
+    bool inside = true, thick = true;
+    for (int v = 0; v < VARIANTS; v++) {
+        const Outline& outline = get(v, 40.f);
+        for (int i = 0; i < ASTEROID_POINTS; i++) {
+            const sf::Vector2f* q = &outline[i * 6];
+            inside = inside && std::hypot(q[0].x, q[0].y) <= 40.001f;
+
+            // both outer corners of an edge quad are the thickness away from the inner edge's line
+            const sf::Vector2f d = q[2] - q[0];
+            const float length = std::hypot(d.x, d.y);
+            const sf::Vector2f n(d.y / length, -d.x / length);
+            const float t0 = (q[1] - q[0]).x * n.x + (q[1] - q[0]).y * n.y;
+            const float t1 = (q[5] - q[0]).x * n.x + (q[5] - q[0]).y * n.y;
+            thick = thick && std::fabs(t0 - ASTEROID_OUTLINE) < 1e-3f && std::fabs(t1 - ASTEROID_OUTLINE) < 1e-3f;
+        }
+    }
+    check("every variant inside its radius", inside);
+    check("outline thickness on every edge of every variant", thick);
+
+    return ok;
+}
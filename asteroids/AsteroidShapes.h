@@ -0,0 +1,36 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+constexpr int ASTEROID_POINTS = 8;              // 8-sided asteroid
+constexpr float ASTEROID_OUTLINE = 2.f;         // outline thickness, drawn outside the points
+
+// Asteroid outlines in local space, as the triangles BatchRenderer draws. The unit polygons and
+// their outline directions are computed at compile time. Every asteroid gets one of VARIANTS shapes,
+// picked from its entity id, and the outline of a shape at a radius is built once, by a multiply-add
+// per vertex over the unit table, then shared by all asteroids of that shape and radius.
+class AsteroidShapes {
+public:
+    static constexpr int VARIANTS = 4;              // variant 0 is the regular polygon
+    static constexpr bool JAGGED = true;            // false draws every asteroid as variant 0
+    static constexpr int RADIUS_BUCKETS = 256;      // a whole radius each, snapshots send the radius as a byte
+    static constexpr int VERTICES = ASTEROID_POINTS * 6;    // a quad per outline edge
+
+    using Outline = std::array<sf::Vector2f, VERTICES>;
+
+    // Same variant for an entity for its whole lifetime, a reused slot gets a new one
+    static int variant(uint32_t id);
+
+    // Render thread. Built on first use, the reference stays valid
+    static const Outline& get(int variant, float radius);
+
+    // Checks outlines are shared per bucket, variants spread over ids, and every variant stays
+    // inside its radius with the outline thickness on every edge
+    static bool selfCheck(std::ostream& os);
+
+private:
+    static std::array<std::array<Outline, RADIUS_BUCKETS>, VARIANTS> outlines;
+    static std::array<std::array<bool, RADIUS_BUCKETS>, VARIANTS> built;
+};
@@ -0,0 +1,218 @@
+#include "BatchRenderer.h"
+#include "Global.h"
+
+#include <cmath>
+#include <vector>
+
+sf::VertexArray BatchRenderer::bullet_vertices(sf::Triangles);
+sf::VertexArray BatchRenderer::asteroid_vertices(sf::Triangles);
+sf::VertexArray BatchRenderer::spaceship_vertices(sf::Triangles);
+
+namespace {
+    // Unit circle, shared by every bullet
+    struct BulletFan {
+        sf::Vector2f points[BatchRenderer::BULLET_SEGMENTS + 1];
+
+        BulletFan() {
+            for (int i = 0; i <= BatchRenderer::BULLET_SEGMENTS; i++) {
+                float rad = (i / (float)BatchRenderer::BULLET_SEGMENTS) * 2.f * (float)M_PI;
+                points[i] = sf::Vector2f(std::cos(rad), std::sin(rad));
+            }
+        }
+    };
+    const BulletFan bullet_fan;
+
+    // Rotation by degrees, then translation, as sf::Transform().translate(t).rotate(degrees)
+    struct Placement {
+        float c, s;
+        sf::Vector2f t;
+
+        Placement(sf::Vector2f translation, float degrees) : t(translation) {
+            float rad = degrees * (float)M_PI / 180.f;
+            c = std::cos(rad);
+            s = std::sin(rad);
+        }
+
+        sf::Vector2f operator()(sf::Vector2f p) const {
+            return sf::Vector2f(p.x * c - p.y * s + t.x, p.x * s + p.y * c + t.y);
+        }
+    };
+}
+
+int BatchRenderer::wrapOffsets(sf::Vector2f position, float extent, sf::Vector2f offsets[4]) {
+    int n = 0;
+    offsets[n++] = sf::Vector2f(0, 0);
+
+    // Only the window wraps. Asteroids and bullets also travel the world outside it, a copy of
+    // one there would be drawn on screen where nothing is
+    if (position.x < 0 || position.x > SCREEN_WIDTH || position.y < 0 || position.y > SCREEN_HEIGHT) {
+        return n;
+    }
+
+    float dx = 0, dy = 0;
+    if (position.x < extent) dx = SCREEN_WIDTH;
+    else if (position.x > SCREEN_WIDTH - extent) dx = -SCREEN_WIDTH;
+    if (position.y < extent) dy = SCREEN_HEIGHT;
+    else if (position.y > SCREEN_HEIGHT - extent) dy = -SCREEN_HEIGHT;
+
+    if (dx != 0) offsets[n++] = sf::Vector2f(dx, 0);
+    if (dy != 0) offsets[n++] = sf::Vector2f(0, dy);
+    if (dx != 0 && dy != 0) offsets[n++] = sf::Vector2f(dx, dy);   // corner
+    return n;
+}
+
+void BatchRenderer::buildAsteroids(EntityPool<Asteroid>& asteroids, sf::VertexArray& out) {
+    out.setPrimitiveType(sf::Triangles);
+    out.clear();
+
+    // At their own position only, the server wraps them over twice the window
+    asteroids.forEach([&out](const Asteroid& a) {
+        const Placement place(a.position, a.angle);
+        for (const sf::Vector2f& v : *a.shape) {
+            out.append(sf::Vertex(place(v), sf::Color::White));
+        }
+        });
+}
+
+void BatchRenderer::buildBullets(EntityPool<Bullet>& bullets, sf::VertexArray& out) {
+    out.setPrimitiveType(sf::Triangles);
+    out.clear();
+
+    // Bullets fly on out of the window until the server culls them, never wrapped
+    bullets.forEach([&out](const Bullet& b) {
+        for (int i = 0; i < BULLET_SEGMENTS; i++) {
+            out.append(sf::Vertex(b.position, b.player_color));
+            out.append(sf::Vertex(b.position + bullet_fan.points[i] * BULLET_RADIUS, b.player_color));
+            out.append(sf::Vertex(b.position + bullet_fan.points[i + 1] * BULLET_RADIUS, b.player_color));
+        }
+        });
+}
+
+void BatchRenderer::buildSpaceships(const std::unordered_map<uint8_t, Player*>& players, sf::VertexArray& out) {
+    out.setPrimitiveType(sf::Triangles);
+    out.clear();
+
+    for (const auto& [sessionID, player] : players) {
+        const sf::VertexArray& ship = player->getVertices();
+
+        sf::Vector2f offsets[4];
+        const int copies = wrapOffsets(player->position, SPACESHIP_EXTENT, offsets);
+
+        for (int c = 0; c < copies; c++) {
+            const Placement place(player->position + offsets[c], player->angle);
+            for (size_t i = 0; i < ship.getVertexCount(); i++) {
+                out.append(sf::Vertex(place(ship[i].position), ship[i].color));
+            }
+        }
+    }
+}
+
+void BatchRenderer::render(sf::RenderWindow& window, EntityPool<Bullet>& bullets, EntityPool<Asteroid>& asteroids,
+    const std::unordered_map<uint8_t, Player*>& players) {
+    buildBullets(bullets, bullet_vertices);
+    buildAsteroids(asteroids, asteroid_vertices);
+    buildSpaceships(players, spaceship_vertices);
+
+    window.draw(bullet_vertices);
+    window.draw(asteroid_vertices);
+    window.draw(spaceship_vertices);
+}
+
+bool BatchRenderer::selfCheck(std::ostream& os) {
+    os << "batch renderer self check, geometry built without a window" << std::endl;
+
+    bool ok = true;
+    const auto check = [&](const char* name, bool passed) {
+        os << "\t" << name << (passed ? ": ok" : ": FAILED") << std::endl;
+        ok = ok && passed;
+    };
+    const auto distance = [](sf::Vector2f a, sf::Vector2f b) { return std::hypot(a.x - b.x, a.y - b.y); };
+    const auto entity = [](uint32_t id, float x, float y, float radius, uint8_t sid) {
+        SnapshotDecoder::Entity e;
+        e.id = id;
+        e.x = x;
+        e.y = y;
+        e.radius = radius;
+        e.sid = sid;
+        return e;
+    };
+
+    sf::Vector2f offsets[4];
+    check("no wrap copy in the middle", wrapOffsets(sf::Vector2f(800, 450), 25, offsets) == 1);
+    check("one wrap copy near the left edge",
+        wrapOffsets(sf::Vector2f(10, 450), 25, offsets) == 2 && offsets[1] == sf::Vector2f((float)SCREEN_WIDTH, 0));
+    check("three wrap copies near a corner",
+        wrapOffsets(sf::Vector2f(1590, 890), 25, offsets) == 4 && offsets[3] == sf::Vector2f((float)-SCREEN_WIDTH, (float)-SCREEN_HEIGHT));
+    check("no wrap copy outside the window",
+        wrapOffsets(sf::Vector2f(-10, 450), 25, offsets) == 1 && wrapOffsets(sf::Vector2f(800, 910), 25, offsets) == 1);
+
+    sf::VertexArray vertices;
+
+    // Regular asteroids in the middle, at an edge, in a corner and in the world outside the window
+    EntityPool<Asteroid> asteroids;
+    const std::vector<SnapshotDecoder::Entity> asteroid_entities = {
+        entity(1, 800, 450, 30, 0), entity(2, 10, 450, 20, 0), entity(3, 5, 5, 40, 0), entity(6, -800, -450, 40, 0) };
+    asteroids.sync(asteroid_entities, [](Asteroid& a, const SnapshotDecoder::Entity& e, bool) {
+        a.position = sf::Vector2f(e.x, e.y);
+        a.angle = 0;
+        a.variant = 0;
+        a.setRadius(e.radius);
+        });
+    buildAsteroids(asteroids, vertices);
+    check("asteroid vertices without copies", vertices.getVertexCount() == (size_t)4 * ASTEROID_VERTICES);
+
+    // Last asteroid: nothing of it in the window
+    bool outside = true;
+    for (int i = 3 * ASTEROID_VERTICES; i < 4 * ASTEROID_VERTICES; i++) {
+        const sf::Vector2f p = vertices[i].position;
+        outside = outside && (p.x < 0 || p.x > SCREEN_WIDTH || p.y < 0 || p.y > SCREEN_HEIGHT);
+    }
+    check("asteroid outside the window drawn only there", outside);
+
+    // First asteroid: inner corners on the radius, edges of the outer ring the outline thickness further out
+    bool on_radius = true, thick = true;
+    for (int i = 0; i < ASTEROID_VERTICES; i += 6) {
+        const sf::Vector2f center(800, 450);
+        const sf::Vector2f in0 = vertices[i].position, out0 = vertices[i + 1].position;
+        const sf::Vector2f in1 = vertices[i + 2].position, out1 = vertices[i + 5].position;
+        on_radius = on_radius && std::fabs(distance(in0, center) - 30) < 1e-3f && std::fabs(distance(in1, center) - 30) < 1e-3f;
+        thick = thick && std::fabs(distance((out0 + out1) * 0.5f, center) - distance((in0 + in1) * 0.5f, center) - ASTEROID_OUTLINE) < 1e-3f;
+        thick = thick && vertices[i].color == sf::Color::White;
+    }
+    check("asteroid corners on the radius", on_radius);
+    check("asteroid outline thickness", thick);
+
+    // Bullets in the middle and at the right edge
+    EntityPool<Bullet> bullets;
+    const std::vector<SnapshotDecoder::Entity> bullet_entities = { entity(4, 100, 100, 0, 1), entity(5, 1598, 100, 0, 2) };
+    bullets.sync(bullet_entities, [](Bullet& b, const SnapshotDecoder::Entity& e, bool) {
+        b.position = sf::Vector2f(e.x, e.y);
+        b.setColor(sf::Color(e.sid, 0, 0));
+        });
+    buildBullets(bullets, vertices);
+    check("bullet vertices without copies", vertices.getVertexCount() == (size_t)2 * BULLET_VERTICES);
+
+    bool fan = vertices[0].position == sf::Vector2f(100, 100) && vertices[0].color == sf::Color(1, 0, 0);
+    for (int i = 0; i < BULLET_VERTICES; i++) {
+        if (i % 3 != 0) {
+            fan = fan && std::fabs(distance(vertices[i].position, sf::Vector2f(100, 100)) - BULLET_RADIUS) < 1e-4f;
+        }
+    }
+    check("bullet fan radius and color", fan);
+    check("bullet at the right edge at its own position", vertices[BULLET_VERTICES].position == sf::Vector2f(1598, 100));
+
+    // A ship turned 90 degrees points down, away from the edges, then one in the corner
+    Player ship(3, sf::Color(0, 255, 0), sf::Vector2f(400, 300), 90.f);
+    std::unordered_map<uint8_t, Player*> players{ { 3, &ship } };
+    buildSpaceships(players, vertices);
+    check("spaceship vertices without copies", vertices.getVertexCount() == SPACESHIP_VERTICES);
+    check("spaceship rotation",
+        distance(vertices[0].position, sf::Vector2f(400, 320)) < 1e-3f && distance(vertices[1].position, sf::Vector2f(415, 280)) < 1e-3f);
+    check("spaceship color", vertices[0].color == sf::Color(0, 255, 0));
+
+    ship.position = sf::Vector2f(5, 5);
+    buildSpaceships(players, vertices);
+    check("spaceship vertices with 4 copies", vertices.getVertexCount() == (size_t)4 * SPACESHIP_VERTICES);
+
+    return ok;
+}
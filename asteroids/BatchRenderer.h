@@ -0,0 +1,49 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <ostream>
+#include <unordered_map>
+#include "Asteroid.h"
+#include "Bullet.h"
+#include "Player.h"
+#include "EntityPool.h"
+
+// Draws every asteroid, every bullet and every spaceship with one draw call per kind.
+// Each frame the geometry of a kind is written, already rotated and translated, into one
+// sf::Triangles vertex array that keeps its capacity across frames. Spaceships close enough to an
+// edge to show on the other side are written again shifted by the screen size. Asteroids and
+// bullets are not, the server moves them over a world twice the window in each direction.
+// The build functions only fill vertex arrays and need no window, so they can be checked headless.
+class BatchRenderer {
+public:
+    static constexpr int BULLET_SEGMENTS = 12;
+
+    // Vertices written per drawn copy of one entity
+    static constexpr int ASTEROID_VERTICES = AsteroidShapes::VERTICES;
+    static constexpr int BULLET_VERTICES = BULLET_SEGMENTS * 3;       // a triangle fan
+    static constexpr int SPACESHIP_VERTICES = 3;
+
+    static constexpr float SPACESHIP_EXTENT = 25.f;     // furthest ship vertex from its position
+
+    // Offsets to draw an entity at so it also shows on the far side of edges within extent.
+    // The first offset is always (0, 0), returns how many were written (1 to 4). Outside the
+    // window there is nothing to wrap and only (0, 0) is written
+    static int wrapOffsets(sf::Vector2f position, float extent, sf::Vector2f offsets[4]);
+
+    // Clear out and write the geometry of all entities of a kind into it
+    static void buildAsteroids(EntityPool<Asteroid>& asteroids, sf::VertexArray& out);
+    static void buildBullets(EntityPool<Bullet>& bullets, sf::VertexArray& out);
+    static void buildSpaceships(const std::unordered_map<uint8_t, Player*>& players, sf::VertexArray& out);
+
+    // Builds and draws all three kinds, bullets first and spaceships on top
+    static void render(sf::RenderWindow& window, EntityPool<Bullet>& bullets, EntityPool<Asteroid>& asteroids,
+        const std::unordered_map<uint8_t, Player*>& players);
+
+    // Builds known entities headless and checks wrap copies only inside the window, vertex counts,
+    // asteroid outline thickness, bullet fan radius and spaceship rotation
+    static bool selfCheck(std::ostream& os);
+
+private:
+    static sf::VertexArray bullet_vertices;
+    static sf::VertexArray asteroid_vertices;
+    static sf::VertexArray spaceship_vertices;
+};
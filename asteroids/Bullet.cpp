@@ -2,20 +2,19 @@
 #include "GameLogic.h"
 #include "Player.h"
 
-Bullet::Bullet() : Entity(sf::Vector2f(0.f, 0.f), 0), shape(1.f), direction(sf::Vector2f(0.f, 0.f)), lifetime(BULLET_LIFETIME), player_color(sf::Color(255,255,255,255)), sid(0) {
+Bullet::Bullet() : direction(sf::Vector2f(0.f, 0.f)), lifetime(BULLET_LIFETIME), position(0.f, 0.f), player_color(sf::Color(255,255,255,255)), sid(0) {
    
 };
 
 Bullet::Bullet(const Bullet& bullet)
-    : Entity(bullet),               // Copy the base class (Entity) data
-    shape(bullet.shape),           // Copy the shape (for rendering)
-    direction(bullet.direction),   // Copy the direction
+    : direction(bullet.direction),   // Copy the direction
     lifetime(bullet.lifetime),     // Copy lifetime
+    position(bullet.position),     // Copy the position
     sid(bullet.sid),               // Copy the SID
     player_color(bullet.player_color)            // Copy the owner pointer
 {}
 
-Bullet::Bullet(sf::Vector2f pos, sf::Vector2f dir, uint8_t sid) :Entity(pos, 0.f), shape(1.f), direction(dir),  lifetime(BULLET_LIFETIME), player_color(sf::Color(255, 255, 255, 255)), sid(sid) {
+Bullet::Bullet(sf::Vector2f pos, sf::Vector2f dir, uint8_t sid) : direction(dir),  lifetime(BULLET_LIFETIME), position(pos), player_color(sf::Color(255, 255, 255, 255)), sid(sid) {
 
 }
 
@@ -50,14 +49,8 @@ void Bullet::update(float delta_time)
     }
 }
 
-void Bullet::render(sf::RenderWindow& window)
-{
-    shape.setPosition(position);
-    shape.setRadius(4.f);
-    window.draw(shape);
-}
 void Bullet::setColor(sf::Color color)
 {
-    shape.setFillColor(color);
+    player_color = color;
 }
 ;
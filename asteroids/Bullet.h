@@ -6,14 +6,16 @@
 // PLAYER VARIABLES
 constexpr float BULLET_SPEED = 750.f;
 constexpr float BULLET_LIFETIME = 2.f;      // shldnt be used
+constexpr float BULLET_RADIUS = 4.f;
 
 
-class Bullet : public Entity {
+// Held by value in GameLogic::bullets, no virtual functions
+class Bullet {
 private:
-    sf::CircleShape shape;
     sf::Vector2f direction;
     float lifetime;
 public:
+    sf::Vector2f position;
     uint8_t sid;
 
     sf::Color player_color;
@@ -24,9 +26,7 @@ public:
 
     Bullet(sf::Vector2f pos, sf::Vector2f dir, uint8_t sid);
 
-    void update(float delta_time) override;
-
-    void render(sf::RenderWindow& window) override;
+    void update(float delta_time);
 
     void setColor(sf::Color color);
 };
@@ -0,0 +1,102 @@
+#include "EntityPool.h"
+
+#include <random>
+
+namespace {
+    // Counts its constructions and destructions, like the shapes pooled items own
+    struct CountedItem {
+        static long constructed;
+        static long destroyed;
+
+        uint32_t id = 0;
+        float x = 0;
+
+        CountedItem() { constructed++; }
+        CountedItem(const CountedItem& other) : id(other.id), x(other.x) { constructed++; }
+        ~CountedItem() { destroyed++; }
+    };
+    long CountedItem::constructed = 0;
+    long CountedItem::destroyed = 0;
+}
+
+bool entityPoolSelfCheck(std::ostream& os) {
+    constexpr int SYNCS = 20000, WARMUP = 1000, MAX_LIVE = 300;
+
+    // Server side ids: free slots are reused first, a released slot gets a new generation
+    std::vector<uint16_t> generations(4096), free_slots;
+    uint16_t next_slot = 0;
+    auto allocate = [&]() {
+        uint16_t s;
+        if (!free_slots.empty()) {
+            s = free_slots.back();
+            free_slots.pop_back();
+        }
+        else {
+            s = next_slot++;
+        }
+        return (uint32_t)generations[s] << 16 | s;
+    };
+
+    std::mt19937 rng(3);
+    std::vector<uint32_t> alive;
+    std::vector<SnapshotDecoder::Entity> snapshot;
+    EntityPool<CountedItem> pool;
+
+    long constructed_after_warmup = 0, destroyed_after_warmup = 0;
+    size_t mismatches = 0;
+
+    for (int f = 0; f < SYNCS; f++) {
+        // a few spawn and a few die every snapshot, like bullets
+        for (int k = 0; k < 6 && alive.size() < MAX_LIVE; k++) {
+            alive.push_back(allocate());
+        }
+        for (int k = 0, n = (int)(rng() % 12); k < n && !alive.empty(); k++) {
+            const size_t i = rng() % alive.size();
+            const uint16_t s = alive[i] & 0xffff;
+            generations[s]++;
+            free_slots.push_back(s);
+            alive[i] = alive.back();
+            alive.pop_back();
+        }
+
+        snapshot.clear();
+        for (uint32_t id : alive) {
+            SnapshotDecoder::Entity e;
+            e.id = id;
+            e.x = (float)f;
+            snapshot.push_back(e);
+        }
+
+        if (f == WARMUP) {
+            constructed_after_warmup = CountedItem::constructed;
+            destroyed_after_warmup = CountedItem::destroyed;
+        }
+
+        pool.sync(snapshot, [](CountedItem& item, const SnapshotDecoder::Entity& e, bool added) {
+            if (added) {
+                item.id = e.id;
+            }
+            item.x = e.x;
+            });
+
+        // every entity maps to its own item, updated this sync
+        for (uint32_t id : alive) {
+            const CountedItem* item = pool.find(id);
+            if (!item || item->id != id || item->x != (float)f) {
+                mismatches++;
+            }
+        }
+        if (pool.size() != alive.size()) {
+            mismatches++;
+        }
+    }
+
+    const long constructed = CountedItem::constructed - constructed_after_warmup;
+    const long destroyed = CountedItem::destroyed - destroyed_after_warmup;
+    const bool ok = mismatches == 0 && constructed == 0 && destroyed == 0;
+
+    os << "entity pool self check, " << SYNCS - WARMUP << " snapshots of up to " << MAX_LIVE << " churning entities after warm up" << std::endl;
+    os << "\titems constructed " << constructed << ", destroyed " << destroyed << ", lookup mismatches " << mismatches
+        << (ok ? "" : " FAILED") << std::endl;
+    return ok;
+}
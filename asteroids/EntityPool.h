@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "SnapshotDecoder.h"
+
+// Client side copies of one kind of server entity, kept in place across snapshots.
+// Server ids are a slot index in the low 16 bits and a generation in the high 16 bits, and the
+// server reuses free slots first, so items are stored by slot in one vector and looked up without
+// hashing. An entity keeps its item for its whole lifetime and a removed entity's item is reused
+// by the next one in its slot, so once the pool has grown to the busiest match nothing is allocated
+// or freed per snapshot, including the shapes the items own.
+template <typename T>
+class EntityPool {
+public:
+    // Makes the pool hold exactly the given entities. assign(T&, const SnapshotDecoder::Entity&, bool added)
+    // updates an item, added is true when the item held another entity or none before
+    template <typename Assign>
+    void sync(const std::vector<SnapshotDecoder::Entity>& entities, Assign assign) {
+        // Items of entities that are gone stay constructed, for reuse
+        live.clear();
+        syncs++;
+
+        for (const SnapshotDecoder::Entity& e : entities) {
+            const uint16_t s = slot(e.id);
+            if (s >= items.size()) {
+                items.resize(s + 1);
+                ids.resize(s + 1);
+                synced.resize(s + 1);
+            }
+
+            const bool added = synced[s] != syncs - 1 || ids[s] != e.id;
+            ids[s] = e.id;
+            synced[s] = syncs;
+            live.push_back(s);
+            assign(items[s], e, added);
+        }
+    }
+
+    // nullptr if the entity is not in the pool
+    T* find(uint32_t id) {
+        const uint16_t s = slot(id);
+        return s < ids.size() && synced[s] == syncs && ids[s] == id ? &items[s] : nullptr;
+    }
+
+    template <typename Fn>
+    void forEach(Fn fn) {
+        for (uint16_t s : live) {
+            fn(items[s]);
+        }
+    }
+
+    size_t size() const { return live.size(); }
+
+    void clear() {
+        live.clear();
+        syncs++;
+    }
+
+private:
+    static uint16_t slot(uint32_t id) { return id & 0xffff; }
+
+    std::vector<T> items;           // by slot, constructed once per slot
+    std::vector<uint32_t> ids;      // entity in each slot, when synced says it is there
+    std::vector<uint32_t> synced;   // sync a slot was last occupied in
+    std::vector<uint16_t> live;     // occupied slots in snapshot order
+    uint32_t syncs = 1;             // slots start out synced in 0, before the first sync
+};
+
+// Churns ids through a pool the way the server allocates them, checks every entity is found and
+// that no item is constructed or destroyed once the pool has grown to the busiest snapshot
+bool entityPoolSelfCheck(std::ostream& os);
@@ -2,6 +2,12 @@
 #include "Asteroid.h"
 #include "Player.h"
 #include "Bullet.h"
+#include "ReliableSender.h"
+#include "SnapshotDecoder.h"
+#include "SnapshotBuffer.h"
+#include "Prediction.h"
+#include "BatchRenderer.h"
+#include "packetbuffer.h"
 
 #include <iostream>
 #include <winsock2.h>
@@ -12,6 +18,7 @@
 #pragma comment(lib, "ws2_32.lib")  // Link Winsock library
 
 #define LOCALHOST_DEV  // for developing on 1 machine
+//#define VERBOSE_LOGGING  // a line per snapshot and spaceship, stalls the receive thread snapshots are timed on
 
 std::string playername;
 //
@@ -30,6 +37,7 @@ int SERVER_PORT;
 std::thread recvUdpThread;
 std::thread recvBroadcastThread;
 std::thread keepAliveThread;
+std::thread reliableSenderThread;
 
 SOCKET udpSocket;
 sockaddr_in serverAddr;
@@ -42,8 +50,6 @@ uint16_t udpBroadcastPort;
 bool isRunning = true;  // Used for network thread
 
 int seq{};      // for packets that require ack
-std::unordered_set<int> acked_seq;      // acked sequence numbers, once processed, will be popped
-std::mutex acked_seq_mutex;
 
 static constexpr int MAX_PACKET_SIZE = 1000;
 
@@ -55,7 +61,8 @@ enum CLIENT_REQUESTS {
     SELF_SPACESHIP,
     NEW_BULLET,
     ACK_END_GAME,
-    KEEP_ALIVE
+    KEEP_ALIVE,
+    ACK_ALL_ENTITIES
 };
 
 enum SERVER_MSGS {
@@ -68,18 +75,17 @@ enum SERVER_MSGS {
 };
 
 // Entities lists
-std::vector<Entity*> GameLogic::entities{};
+EntityPool<Bullet> GameLogic::bullets{};
+EntityPool<Asteroid> GameLogic::asteroids{};
 //std::list<Entity*> GameLogic::entitiesToDelete{};
 //std::list<Entity*> GameLogic::entitiesToAdd{};
 std::unordered_map<uint8_t, Player*> GameLogic::players{};
 std::unordered_map<int, std::string> playersNames;
 std::map<int, std::string, std::greater<int>> leaderboard;
 
-// Store the most recent entity updates in a global variable
-std::vector<Player> updatedPlayers;
-std::vector<Bullet> updatedBullets;
-std::vector<Asteroid> updatedAsteroids;
-bool updatedEntities;
+// Entities as rendered this frame, sampled from SnapshotBuffer
+SnapshotDecoder::State interpolatedEntities;
+uint32_t latest_snapshot_seq{};     // newest ALL_ENTITIES received
 
 // Game conditions
 float GameLogic::game_timer;
@@ -106,7 +112,11 @@ std::vector<sf::Color> player_colors = {
 
 // Send player input
 void sendData(const std::vector<char>& buffer) {
-    int sendResult = sendto(udpSocket, buffer.data(), buffer.size(), 0,
+    sendData(buffer.data(), (int)buffer.size());
+}
+
+void sendData(const char* buffer, int length) {
+    int sendResult = sendto(udpSocket, buffer, length, 0,
         (sockaddr*)&serverAddr, sizeof(serverAddr));
     if (sendResult == SOCKET_ERROR) {
         std::cerr << "Failed to send data: " << WSAGetLastError() << "\n";
@@ -116,6 +126,29 @@ void sendData(const std::vector<char>& buffer) {
     }
 }
 
+// Ack a reliable server message, cmd - session id - seq number (4 bytes, as received)
+void sendAck(char cmd, uint8_t sid, const char* seq) {
+    char buffer[6];
+    BufferWriter writer(buffer);
+    writer.u8((uint8_t)cmd);
+    writer.u8(sid);
+    writer.bytes(seq, 4);
+    sendData(buffer, (int)writer.size());
+}
+
+// Own spaceship input, cmd - session id - velocity x - velocity y - rotation
+void sendSelfSpaceship(const Player& player) {
+    char buffer[18];
+    BufferWriter writer(buffer);
+    writer.u8(SELF_SPACESHIP);
+    writer.u8(current_session_id);
+    writer.u32(Prediction::record(player.velocity.x, player.velocity.y, Prediction::Clock::now()));
+    writer.f32(player.velocity.x);
+    writer.f32(player.velocity.y);
+    writer.f32(player.angle);
+    sendData(buffer, (int)writer.size());
+}
+
 // Handles ack from server
 void listenForUdpMessages() {
     char buffer[MAX_PACKET_SIZE];
@@ -129,24 +162,21 @@ void listenForUdpMessages() {
             (sockaddr*)&senderAddr, &senderAddrSize);
 
         if (bytesReceived > 0) {
-            uint8_t cmd = buffer[0]; // First byte is the command identifier
-            std::vector<char> send_buffer;
+            BufferReader reader(buffer, (size_t)bytesReceived);
+            uint8_t cmd = reader.u8(); // First byte is the command identifier
             switch (cmd) {
             case CONN_ACCEPTED:
             {
-                send_buffer.clear();
-                send_buffer.push_back(ACK_CONN_REQUEST);
-                std::cout << "send_buffer: ";
-                for (char c : send_buffer) {
-                    std::cout << static_cast<int>(c) << " ";  // Print as integers
-                }
-                sendData(send_buffer);
+                // retransmitted CONN_ACCEPTED, previous ack was lost
+                sendAck(ACK_CONN_REQUEST, current_session_id, buffer + 1);
                 break;
             }
             case ACK_NEW_BULLET:
             {
-                std::lock_guard<std::mutex> aclock(acked_seq_mutex);
-                acked_seq.insert(buffer[1] << 24 | buffer[2] << 16 | buffer[3] << 8 | buffer[4]);
+                const uint32_t bullet_id = reader.u32();
+                if (reader.ok()) {
+                    ReliableSender::ack(bullet_id);
+                }
             }
                 //std::cout << "Received ACK_SELF_SPACESHIP.\n";
                 
@@ -212,8 +242,8 @@ void listenForBroadcast() {
         int bytesReceived = recvfrom(udpBroadcastSocket, buffer, sizeof(buffer) - 1, 0, (sockaddr*)&senderAddr, &senderAddrSize);
         if (bytesReceived > 0) {
 
-            char cmd = buffer[0];
-            std::vector<char> send_buffer;
+            BufferReader reader(buffer, (size_t)bytesReceived);
+            char cmd = (char)reader.u8();
 
             switch (cmd) {
                 case START_GAME:
@@ -225,147 +255,94 @@ void listenForBroadcast() {
                     }
 
 
-                    int offset = 2;
-                    for (int i{}; i < buffer[1]; i++) {     // iterate through num players
-                        int sid = buffer[offset++];
-                        int playernamesize = buffer[offset++];
-                        std::string playerName;
-                        for (int j{}; j < playernamesize; j++) {    // iterate through num chars in player name
-                            playerName += buffer[offset + j];
+                    reader.u32();   // seq number
+                    int num_players = reader.u8();
+                    for (int i{}; i < num_players; i++) {     // iterate through num players
+                        int sid = reader.u8();
+                        int playernamesize = reader.u8();
+                        const char* playerName = reader.bytes(playernamesize);
+                        if (!playerName) {
+                            break;
                         }
-                        playersNames[sid] = playerName;
-
-                        offset += playernamesize;
+                        playersNames[sid] = std::string(playerName, playernamesize);
                     }
 
-                    // Example: Send ACK_START_GAME back to sender
-                    send_buffer = { ACK_START_GAME };
-                    sendData(send_buffer);
+                    // Send ACK_START_GAME back to sender
+                    sendAck(ACK_START_GAME, current_session_id, buffer + 1);
                 }
                 break;
                 case ALL_ENTITIES: {
+#ifdef VERBOSE_LOGGING
                     std::cout << "Received ALL_ENTITIES update (" << bytesReceived << " bytes).\n";
+#endif
 
-                    if (bytesReceived < 2) {
-                        std::cerr << "Error: Packet too short for ALL_ENTITIES\n";
+                    const SnapshotDecoder::State* snapshot = SnapshotDecoder::decode(buffer, bytesReceived);
+                    if (!snapshot) {
+                        std::cerr << "Error: Could not decode ALL_ENTITIES\n";
                         break;
                     }
 
-                    int offset = 1;  // Skip packet type
-                    int num_spaceships = buffer[offset++];
-                    updatedPlayers.clear();
+                    // Server can now use this snapshot as a baseline
+                    sendAck(ACK_ALL_ENTITIES, current_session_id, buffer + 1);
 
-                    // Read Player Data (15 bytes per spaceship)
-                    for (int i = 0; i < num_spaceships; i++) {
-                        if (offset + 15 > bytesReceived) {
-                            std::cerr << "Error: Not enough bytes for spaceship data\n";
-                            break;
-                        }
-
-                        Player s;
-                        s.sid = buffer[offset++];
-                        s.position.x = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += 4;
-                        s.position.y = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += 4;
-                        s.angle = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += 4;
-                        s.lives_left = buffer[offset++];  // 1 byte for lives_left (no need for memcpy)
-                        s.score = buffer[offset++];  // 1 byte for score (no need for memcpy)
-                        s.player_color = player_colors[s.sid];
-
-                        updatedPlayers.push_back(s);
-                        updatedEntities = true;
-                        std::cout << "Spaceship SID: " << static_cast<int>(s.sid)
-                            << " | Pos: (" << s.position.x << ", " << s.position.y << ")"
-                            << " | Angle : " << s.angle
-                            << " | Lives: " << (int)s.lives_left
-                            << " | Score: " << (int)s.score << "\n";
-                    }
-
-                    int num_bullets = buffer[offset++];
-
-                    updatedBullets.clear();
-                    // Read Bullet Data (9 bytes per bullet)
-                    for (int i = 0; i < num_bullets; i++) {
-                        if (offset + 9 > bytesReceived) {
-                            std::cerr << "Error: Not enough bytes for bullet data\n";
-                            break;
-                        }
-
-                        Bullet b;
-                        b.sid = buffer[offset++];  
-                        b.position.x = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += 4;
-                        b.position.y = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += 4;
-                        b.setColor(player_colors[b.sid]);
-                        updatedBullets.push_back(b);
-                        updatedEntities = true;
-                        //std::cout << "Bullet Owner SID: " << b.sid
-                        //    << " | Pos: (" << b.position.x << ", " << b.position.y << ")\n";
+                    if (snapshot->seq <= latest_snapshot_seq) {
+                        // Arrived out of order
+                        break;
                     }
+                    latest_snapshot_seq = snapshot->seq;
 
-                    int num_asteroids = buffer[offset++];
+                    // Rendered a fixed delay later, interpolated with the snapshots around it
+                    SnapshotBuffer::push(*snapshot, SnapshotBuffer::Clock::now());
 
-                    updatedAsteroids.clear();
-
-                    // Read Asteroid Data (8 bytes per asteroid)
-                    for (int i = 0; i < num_asteroids; i++) {
-                        if (offset + 8 > bytesReceived) {
-                            std::cerr << "Error: Not enough bytes for asteroid data\n";
-                            break;
+                    for (const SnapshotDecoder::Entity& e : snapshot->spaceships) {
+                        // Own spaceship is predicted from the newest server position instead
+                        if (e.sid == current_session_id) {
+                            Prediction::authoritative(e, snapshot->tick);
                         }
 
-                        Asteroid a;
-
-                        a.position.x = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += sizeof(float);
-                        a.position.y = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += sizeof(float);
-                        a.radius = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                        offset += sizeof(float);
-                        a.setRadius(a.radius);
-                        updatedAsteroids.push_back(a);
-                        updatedEntities = true;
-                        //std::cout << "Asteroid Pos: (" << a.position.x << ", " << a.position.y << ") Radius = " << a.radius << "\n";
+#ifdef VERBOSE_LOGGING
+                        std::cout << "Spaceship SID: " << static_cast<int>(e.sid)
+                            << " | Pos: (" << e.x << ", " << e.y << ")"
+                            << " | Angle : " << e.rotation
+                            << " | Lives: " << (int)e.lives
+                            << " | Score: " << (int)e.score << "\n";
+#endif
                     }
 
-
                     break;
                 }
 
 
                 case ACK_NEW_BULLET:
+#ifdef VERBOSE_LOGGING
                     std::cout << "Received ACK_SELF_SPACESHIP.\n";
+#endif
                     // Handle spaceship acknowledgment
                     break;
 
                 case END_GAME:
 
-                    int offset = 1;
-                    winner_id = buffer[offset++];
-                    winner_score = buffer[offset++];
-                    uint8_t num_high_scores = buffer[offset++];
+                    reader.u32();   // seq number
+                    winner_id = reader.u8();
+                    winner_score = reader.u8();
+                    uint8_t num_high_scores = reader.u8();
                     
                     for (int i = 0; i < num_high_scores; i++) {
-                        int score = buffer[offset++];
-                        int name_length = buffer[offset++];
+                        int score = reader.u8();
+                        int name_length = reader.u8();
 
-                        std::string name;
-                        for (int j = 0; j < name_length; ++j) {
-                            name.push_back(buffer[offset + j]);
+                        const char* name = reader.bytes(name_length);
+                        if (!name) {
+                            break;
                         }
-                        offset += name_length;
 
                         // Add to the leaderboard
-                        Global::addToLeaderboard(leaderboard, score, name);
+                        Global::addToLeaderboard(leaderboard, score, std::string(name, name_length));
                     }
 
                     GameLogic::gameOver();
                     // Send ACK
-                    send_buffer = { ACK_END_GAME };
-                    sendData(send_buffer);
+                    sendAck(ACK_END_GAME, current_session_id, buffer + 1);
                     break;
 
             }
@@ -438,10 +415,12 @@ bool initNetwork() {
     //  HANDSHAKE FIRST
     
     // Send connection request
-    std::vector<char> conn_buffer = { CONN_REQUEST };
-    conn_buffer.push_back((char)playername.size());
-    conn_buffer.insert(conn_buffer.end(), playername.begin(), playername.end());
-    sendData(conn_buffer);
+    char conn_buffer[MAX_PACKET_SIZE];
+    BufferWriter conn_writer(conn_buffer);
+    conn_writer.u8(CONN_REQUEST);
+    conn_writer.u8((uint8_t)playername.size());
+    conn_writer.bytes(playername.data(), playername.size());
+    sendData(conn_buffer, (int)conn_writer.size());
     std::cout << "Sent connection request to server. Waiting for response...\n";
 
     // Wait for server response
@@ -464,37 +443,36 @@ bool initNetwork() {
         int recvLen = recvfrom(udpSocket, buffer, sizeof(buffer), 0, (sockaddr*)&fromAddr, &fromSize);
 
         if (recvLen > 0) {
-            uint8_t serverMsg = buffer[0];
+            BufferReader reader(buffer, (size_t)recvLen);
+            uint8_t serverMsg = reader.u8();
             std::cout << "Receiving from server!" << serverMsg << std::endl;
 
             if (serverMsg == CONN_ACCEPTED) {
                 std::cout << "Connection accepted by server!\n";
                 connected = true;
 
-                int offset = 1; // Start after the command byte
+                // First rtt sample for the retransmission timeout
+                ReliableSender::sample(std::chrono::duration<double, std::milli>(curr - start).count());
 
-                // Session ID (1 byte)
-                current_session_id = buffer[offset++];
+                // Seq number (4 bytes), echoed back in the ack
+                const char* conn_seq = reader.bytes(4);
 
-                // Read UDP Broadcast Port (2 bytes, ensure correct endian conversion)
-                memcpy(&udpBroadcastPort, buffer + offset, sizeof(uint16_t));
-                udpBroadcastPort = ntohs(udpBroadcastPort); // Convert from network byte order if needed
-                offset += 2;
+                // Session ID (1 byte)
+                current_session_id = reader.u8();
 
-                // Read Spawn X (4 bytes, float)
-                float spawnPosX;
-                spawnPosX = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                offset += sizeof(float);
+                // Read UDP Broadcast Port (2 bytes)
+                udpBroadcastPort = reader.u16();
 
-                // Read Spawn Y (4 bytes, float)
-                float spawnPosY;
-                spawnPosY = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                offset += sizeof(float);
+                // Read Spawn X, Y and rotation (4 bytes each, float)
+                float spawnPosX = reader.f32();
+                float spawnPosY = reader.f32();
+                float spawnRotation = reader.f32();
 
-                // Read Spawn Rotation (4 bytes, float)
-                float spawnRotation;
-                spawnRotation = Global::btof(std::vector<char>(buffer + offset, buffer + offset + sizeof(float)));
-                offset += sizeof(float);
+                if (!reader.ok()) {
+                    // Truncated, the server retransmits CONN_ACCEPTED
+                    connected = false;
+                    continue;
+                }
 
                 std::cout << "Session ID: " << (int)current_session_id << std::endl;
                 std::cout << "UDP Broadcast Port: " << udpBroadcastPort << std::endl;
@@ -504,12 +482,9 @@ bool initNetwork() {
 
                 Player* new_player = new Player(current_session_id, player_colors[current_session_id], sf::Vector2f(spawnPosX, spawnPosY), spawnRotation);
                 GameLogic::players[current_session_id] = new_player; // Store in map
-                GameLogic::entities.push_back(new_player);
 
                 // Send ACK_CONN_REQUEST
-                conn_buffer.clear();
-                conn_buffer.push_back(ACK_CONN_REQUEST);
-                sendData(conn_buffer);
+                sendAck(ACK_CONN_REQUEST, current_session_id, conn_seq);
                 break;
             }
             else if (serverMsg == CONN_REJECTED) {
@@ -528,13 +503,12 @@ bool initNetwork() {
 // Separate thread to handle incoming game state
 void startNetworkThread() {
     recvUdpThread = std::thread(listenForUdpMessages);
+    reliableSenderThread = std::thread(ReliableSender::run);
     recvBroadcastThread = std::thread(listenForBroadcast);
     keepAliveThread = std::thread([]() {
-        std::vector<char> buf;
-        buf.push_back(KEEP_ALIVE);
-        buf.push_back(current_session_id);
+        const char buf[] = { KEEP_ALIVE, (char)current_session_id };
         while (isRunning) {
-            sendData(buf);
+            sendData(buf, (int)sizeof(buf));
             std::this_thread::sleep_for(std::chrono::seconds(2));
         }
         }
@@ -559,6 +533,12 @@ void closeNetwork() {
         keepAliveThread.join();
     }
 
+    ReliableSender::stop();
+    if (reliableSenderThread.joinable()) {
+        reliableSenderThread.join();
+    }
+    ReliableSender::printStats(std::cout);
+
     closesocket(udpSocket);
     closesocket(udpBroadcastSocket);
     WSACleanup();
@@ -666,8 +646,8 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
             //entities.push_back(new_player);
 
             std::cout << "Sending REQ_START_GAME" << std::endl;
-            std::vector<char> conn_buffer = { REQ_START_GAME }; 
-            sendData(conn_buffer);
+            const char conn_buffer[] = { REQ_START_GAME };
+            sendData(conn_buffer, (int)sizeof(conn_buffer));
 
         }
 
@@ -676,16 +656,14 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
     else {
 
         {
-            std::vector<char> buffer;  // Start empty
+            // Every packet is written into its own stack buffer
+            char buffer[MAX_PACKET_SIZE];
+            int buffer_length = 0;
             bool useReliableSender = false;
 
             if (sf::Keyboard::isKeyPressed(sf::Keyboard::A) && window.hasFocus()) {
                 //std::cout << "Rotating" << std::endl;
 
-
-                buffer.push_back(SELF_SPACESHIP);  // Packet type
-                buffer.push_back(static_cast<char>(current_session_id));  // Session ID
-
                 // Ensure player exists
                 if (players.find(current_session_id) == players.end()) {
                     std::cerr << "Error: Player not found!" << std::endl;
@@ -694,38 +672,14 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
 
                 Player* player = players[current_session_id];
 
-                // Append position (x, y)
-                //std::vector<char> bytes = Global::t_to_bytes(player->position.x);
-                //buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                //bytes = Global::t_to_bytes(player->position.y);
-                //buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                // Append velocity (vector.x, vector.y)
-                std::vector<char> bytes = Global::t_to_bytes(player->velocity.x);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                bytes = Global::t_to_bytes(player->velocity.y);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                // Append rotation
+                // Rotate
                 player->angle -= (TURN_SPEED * delta_time);
                 player->angle = std::fmod(player->angle + 360, 360);
 
-                // Convert to bytes and append
-                bytes = Global::t_to_bytes(player->angle);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-
-
-
-                sendData(buffer);
+                sendSelfSpaceship(*player);
             }
 
             if (sf::Keyboard::isKeyPressed(sf::Keyboard::D) && window.hasFocus()) {
-                buffer.push_back(SELF_SPACESHIP);  // Packet type
-                buffer.push_back(static_cast<char>(current_session_id));  // Session ID
-
                 // Ensure player exists
                 if (players.find(current_session_id) == players.end()) {
                     std::cerr << "Error: Player not found!" << std::endl;
@@ -734,31 +688,13 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
 
                 Player* player = players[current_session_id];
 
-                // Append velocity (vector.x, vector.y)
-                std::vector<char> bytes = Global::t_to_bytes(player->velocity.x);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                bytes = Global::t_to_bytes(player->velocity.y);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                // Append rotation
+                // Rotate
                 player->angle += (TURN_SPEED * delta_time);
                 player->angle = std::fmod(player->angle + 360, 360);
 
-                bytes = Global::t_to_bytes(player->angle);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-
-
-                sendData(buffer);
+                sendSelfSpaceship(*player);
             }
             if (sf::Keyboard::isKeyPressed(sf::Keyboard::W) && window.hasFocus()) {
-
-                float radians = players[current_session_id]->angle * (M_PI / 180.f);
-
-                buffer.push_back(SELF_SPACESHIP);  // Packet type
-                buffer.push_back(static_cast<char>(current_session_id));  // Session ID
-
                 // Ensure player exists
                 if (players.find(current_session_id) == players.end()) {
                     std::cerr << "Error: Player not found!" << std::endl;
@@ -766,38 +702,15 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
                 }
 
                 Player* player = players[current_session_id];
+                float radians = player->angle * (M_PI / 180.f);
 
-                // Append position (x, y)
-                //std::vector<char> bytes = Global::t_to_bytes(player->position.x);
-                //buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                //bytes = Global::t_to_bytes(player->position.y);
-                //buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+                // Accelerate forward
+                player->velocity.x += cos(radians) * (ACCELERATION * delta_time);
+                player->velocity.y += sin(radians) * (ACCELERATION * delta_time);
 
-                // Append velocity (vector.x, vector.y)
-                //bytes = Global::t_to_bytes(players[current_session_id]->velocity.x + cos(radians) * (ACCELERATION * delta_time));
-                std::vector<char> bytes = Global::t_to_bytes(players[current_session_id]->velocity.x += cos(radians) * (ACCELERATION * delta_time));
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                //bytes = Global::t_to_bytes(players[current_session_id]->velocity.y + sin(radians) * (ACCELERATION * delta_time));
-                bytes = Global::t_to_bytes(players[current_session_id]->velocity.y += sin(radians) * (ACCELERATION * delta_time));
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                // Append rotation
-                bytes = Global::t_to_bytes(players[current_session_id]->angle);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-
-
-                sendData(buffer);
+                sendSelfSpaceship(*player);
             }
             if (sf::Keyboard::isKeyPressed(sf::Keyboard::S) && window.hasFocus()) {
-
-                float radians = players[current_session_id]->angle * (M_PI / 180.f);
-
-                buffer.push_back(SELF_SPACESHIP);  // Packet type
-                buffer.push_back(static_cast<char>(current_session_id));  // Session ID
-
                 // Ensure player exists
                 if (players.find(current_session_id) == players.end()) {
                     std::cerr << "Error: Player not found!" << std::endl;
@@ -805,30 +718,13 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
                 }
 
                 Player* player = players[current_session_id];
+                float radians = player->angle * (M_PI / 180.f);
 
-                // Append position (x, y)
-                //std::vector<char> bytes = Global::t_to_bytes(player->position.x);
-                //buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                //bytes = Global::t_to_bytes(player->position.y);
-                //buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                // Append velocity (vector.x, vector.y)
-                //bytes = Global::t_to_bytes(players[current_session_id]->velocity.x - cos(radians) * (ACCELERATION * delta_time));
-                std::vector<char> bytes = Global::t_to_bytes(players[current_session_id]->velocity.x -= cos(radians) * (ACCELERATION * delta_time));
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                //bytes = Global::t_to_bytes(players[current_session_id]->velocity.y - sin(radians) * (ACCELERATION * delta_time));
-                bytes = Global::t_to_bytes(players[current_session_id]->velocity.y -= sin(radians) * (ACCELERATION * delta_time));
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                // Append rotation
-                bytes = Global::t_to_bytes(players[current_session_id]->angle);
-                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+                // Accelerate backward
+                player->velocity.x -= cos(radians) * (ACCELERATION * delta_time);
+                player->velocity.y -= sin(radians) * (ACCELERATION * delta_time);
 
-
-
-                sendData(buffer);
+                sendSelfSpaceship(*player);
             }
             if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space)) {
                 static auto last_bullet_fired = std::chrono::high_resolution_clock::now();
@@ -848,68 +744,32 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
 
                     float radians = players[current_session_id]->angle * (M_PI / 180.f);
 
-                    buffer.clear();  // Ensure buffer is clean
-                    buffer.push_back(NEW_BULLET);
-                    buffer.push_back(static_cast<char>(current_session_id));
+                    BufferWriter writer(buffer);
+                    writer.u8(NEW_BULLET);
+                    writer.u8(current_session_id);
 
                     // Add sequence number
-                    buffer.push_back((seq >> 24) & 0xff);
-                    buffer.push_back((seq >> 16) & 0xff);
-                    buffer.push_back((seq >> 8) & 0xff);
-                    buffer.push_back((seq >> 0) & 0xff);
+                    writer.u32((uint32_t)seq);
                     ++seq;
 
                     Player* player = players[current_session_id];
 
                     // Add position
-                    auto bytes = Global::t_to_bytes(player->position.x);
-                    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                    bytes = Global::t_to_bytes(player->position.y);
-                    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+                    writer.f32(player->position.x);
+                    writer.f32(player->position.y);
 
                     // Add bullet velocity
-                    bytes = Global::t_to_bytes(cos(radians) * BULLET_SPEED);
-                    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
-
-                    bytes = Global::t_to_bytes(sin(radians) * BULLET_SPEED);
-                    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+                    writer.f32((float)(cos(radians) * BULLET_SPEED));
+                    writer.f32((float)(sin(radians) * BULLET_SPEED));
 
+                    buffer_length = (int)writer.size();
                     std::cout << "Bullet fired!\n";
                 }
             }
 
 
-            auto reliableSender = [buffer]() {
-                int retries = 5;
-
-                int seq_num = buffer[2] << 24 | buffer[3] << 16 | buffer[4] << 8 | buffer[5];
-
-                while (--retries >= 0) {
-                    // Send the exact-sized buffer
-                    sendData(buffer);
-
-
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-
-                    {
-                        std::lock_guard < std::mutex> aslock(acked_seq_mutex);
-                        if (acked_seq.find(seq_num) != acked_seq.end()) {
-                            // has been acked
-                            acked_seq.erase(seq_num);
-                            return;
-                        }
-                    }
-
-                    // have not been acked
-                }
-
-                std::cerr << "Server did not send ACK_SELF_SPACESHIP for 5 seconds!" << std::endl;
-                };
-
             if (useReliableSender) {
-                std::lock_guard<std::mutex> tplock(Global::threadpool_mutex);
-                Global::threadpool.push_back(std::async(std::launch::async, reliableSender));
+                ReliableSender::send(buffer, buffer_length, seq - 1);
             }
 
             /*asteroid_spawn_time -= delta_time;*/
@@ -920,10 +780,8 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
             //}
             //entitiesToAdd.clear();
 
-            for (size_t i = 0; i < entities.size(); i++) {
-                //entities[i]->update(delta_time);
-                entities[i]->render(window);
-            }
+            // One draw call each for bullets, asteroids and spaceships
+            BatchRenderer::render(window, bullets, asteroids, players);
 
             //for (auto* entity : entitiesToDelete) {
             //    auto it = std::find(entities.begin(), entities.end(), entity);
@@ -981,55 +839,62 @@ void GameLogic::update(sf::RenderWindow& window, float delta_time) {
 
 }
 void GameLogic::applyEntityUpdates() {
+    // Entities a fixed delay behind the server, interpolated between the snapshots around that time
+    if (!SnapshotBuffer::sample(SnapshotBuffer::Clock::now(), interpolatedEntities)) {
+        return;
+    }
+
     // Update players
-// Update players
-    if (updatedEntities) {
-        for (const auto& updatedPlayer : updatedPlayers) {
-            if (players.count(updatedPlayer.sid)) {
-                // Update existing player
-                Player* p = players[updatedPlayer.sid];
-                p->position = updatedPlayer.position;
-
-                if (p->lives_left != updatedPlayer.lives_left) {
-                    p->velocity = updatedPlayer.velocity;
-                    p->lives_left = updatedPlayer.lives_left;
+    for (const SnapshotDecoder::Entity& e : interpolatedEntities.spaceships) {
+        if (players.count(e.sid)) {
+            // Update existing player
+            Player* p = players[e.sid];
+            p->position = sf::Vector2f(e.x, e.y);
+
+            if (p->lives_left != e.lives) {
+                p->velocity = sf::Vector2f(0.f, 0.f);
+                p->lives_left = e.lives;
+
+                // Server stopped the ship too, keep the predicted inputs in line with it
+                if (e.sid == current_session_id) {
+                    sendSelfSpaceship(*p);
                 }
-
-                p->score = updatedPlayer.score;
-
-                if (updatedPlayer.sid != current_session_id)
-                    p->angle = updatedPlayer.angle;
             }
-        }
 
-        // Remove existing bullets & asteroids in a single pass
-        entities.erase(std::remove_if(entities.begin(), entities.end(), [](Entity* e) {
-            if (dynamic_cast<Bullet*>(e) || dynamic_cast<Asteroid*>(e)) {
-                delete e;  // Free memory
-                return true;
+            if (e.sid == current_session_id) {
+                // Inputs the server has not applied yet replayed on its newest position, no delay
+                float x, y;
+                if (Prediction::predict(Prediction::Clock::now(), SnapshotBuffer::clockOffset(),
+                        ReliableSender::srtt() / 1000.0, x, y)) {
+                    p->position = sf::Vector2f(x, y);
+                }
             }
-            return false;
-            }), entities.end());
 
-        // Add updated bullets
-        for (const auto& updatedBullet : updatedBullets) {
-            entities.push_back(new Bullet(updatedBullet));
-        }
+            p->score = e.score;
 
-        // Add updated asteroids
-        for (const auto& updatedAsteroid : updatedAsteroids) {
-            entities.push_back(new Asteroid(updatedAsteroid));
+            if (e.sid != current_session_id)
+                p->angle = e.rotation;
         }
-
-        updatedEntities = false;
     }
 
+    // Update bullets & asteroids in place, new ones reuse the items of removed ones
+    bullets.sync(interpolatedEntities.bullets, [](Bullet& b, const SnapshotDecoder::Entity& e, bool added) {
+        b.position = sf::Vector2f(e.x, e.y);
+        if (added || b.sid != e.sid) {
+            b.sid = e.sid;
+            b.setColor(player_colors[e.sid]);
+        }
+        });
 
-
-    // Clear update buffers
-    //updatedPlayers.clear();
-    //updatedBullets.clear();
-    //updatedAsteroids.clear();
+    asteroids.sync(interpolatedEntities.asteroids, [](Asteroid& a, const SnapshotDecoder::Entity& e, bool added) {
+        a.position = sf::Vector2f(e.x, e.y);
+        if (added) {
+            a.variant = AsteroidShapes::variant(e.id);
+        }
+        if (added || a.radius != e.radius) {
+            a.setRadius(e.radius);
+        }
+        });
 }
 
 
@@ -4,6 +4,9 @@
 #include <unordered_map>
 #include "Entity.h"
 #include "Player.h"
+#include "Bullet.h"
+#include "Asteroid.h"
+#include "EntityPool.h"
 
 class GameLogic
 {
@@ -15,8 +18,9 @@ class GameLogic
 		static void start();
 		static void update(sf::RenderWindow& window, float delta_time);
 
-		// Handle list of entities
-		static std::vector<Entity*> entities;
+		// Bullets and asteroids of the rendered snapshot, updated in place
+		static EntityPool<Bullet> bullets;
+		static EntityPool<Asteroid> asteroids;
 		//static std::list<Entity*> entitiesToDelete;
 		//static std::list<Entity*> entitiesToAdd;
 		static std::unordered_map<uint8_t, Player*> players;
@@ -38,4 +42,7 @@ class GameLogic
 
 void closeNetwork();
 
+void sendData(const std::vector<char>& buffer);
+void sendData(const char* buffer, int length);
+
 
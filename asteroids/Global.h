@@ -38,34 +38,4 @@ public:
      */
 
     static void addToLeaderboard(std::map<int, std::string, std::greater<int>>& leaderboard, int score, const std::string& playerName);
-
-    template <typename T>
-    static std::vector<char> t_to_bytes(T num) {
-        std::vector<char> bytes(sizeof(T));
-
-        if (std::is_integral<T>::value) {
-            // for ints, convert to network byte order
-            num = htonl(num);
-            std::memcpy(bytes.data(), &num, sizeof(T));
-        }
-        else if (std::is_floating_point<T>::value) {
-            // For floats
-            unsigned int int_rep = *reinterpret_cast<unsigned int*>(&num);  // reinterpret float as unsigned int
-            int_rep = htonl(int_rep);
-            std::memcpy(bytes.data(), &int_rep, sizeof(T));
-        }
-
-        return bytes;
-    }
-
-    static float btof(const std::vector<char>& bytes);
-
-    /* thread management */
-
-    static bool threadpool_running;
-
-    static std::deque<std::future<void>> threadpool;
-    static std::mutex threadpool_mutex;
-
-    static void threadpoolManager();
 };
@@ -13,7 +13,7 @@ constexpr float SHOT_DELAY = 500.f;     // in milliseconds
 
 
 
-class Player : public Entity {
+class Player final : public Entity {
     private:
 
         sf::VertexArray vertices;
@@ -43,6 +43,9 @@ class Player : public Entity {
         // Draw player
         void render(sf::RenderWindow& window) override;
 
+        // Ship triangle relative to position, unrotated
+        const sf::VertexArray& getVertices() const { return vertices; }
+
         void death();
 
         void respawn();
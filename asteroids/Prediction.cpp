@@ -0,0 +1,150 @@
+#include "Prediction.h"
+#include "Global.h"
+
+#include <cmath>
+
+std::mutex Prediction::mutex;
+std::deque<Prediction::Input> Prediction::inputs;
+uint32_t Prediction::next_seq = 1;
+Prediction::Authority Prediction::authority;
+Prediction::Authority Prediction::applied;
+float Prediction::error_x = 0;
+float Prediction::error_y = 0;
+double Prediction::last_predict_s = 0;
+
+namespace {
+    constexpr double TICK_DT = 1.0 / Prediction::SERVER_TICK_RATE;
+
+    double seconds(Prediction::Clock::time_point t) {
+        return std::chrono::duration<double>(t.time_since_epoch()).count();
+    }
+
+    // a is at or before b, with wrap around
+    bool seqAtOrBefore(uint32_t a, uint32_t b) {
+        return (int32_t)(b - a) >= 0;
+    }
+
+    // Same steps and wrapping as the server moves spaceships, inside the window
+    void advance(float& x, float& y, float vx, float vy, double dt) {
+        while (dt > 0) {
+            const float step = (float)std::fmin(dt, TICK_DT);
+            const float nx = x + vx * step;
+            const float ny = y + vy * step;
+            x = nx < 0 ? (float)SCREEN_WIDTH : (nx > SCREEN_WIDTH ? 0 : nx);
+            y = ny < 0 ? (float)SCREEN_HEIGHT : (ny > SCREEN_HEIGHT ? 0 : ny);
+            dt -= step;
+        }
+    }
+}
+
+uint32_t Prediction::record(float vx, float vy, Clock::time_point sent) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (inputs.size() == MAX_INPUTS) {
+        inputs.pop_front();
+    }
+    inputs.push_back({ next_seq, seconds(sent), vx, vy });
+    return next_seq++;
+}
+
+void Prediction::authoritative(const SnapshotDecoder::Entity& spaceship, uint32_t tick) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Authority next;
+    next.x = spaceship.x;
+    next.y = spaceship.y;
+    next.tick = tick;
+    next.input_seq = spaceship.input_seq;
+    next.lives = spaceship.lives;
+    next.version = authority.version + 1;
+
+    if (authority.version > 0) {
+        // the server stops a spaceship when it dies and when a match starts, until its next input
+        const bool killed = next.lives < authority.lives || tick < authority.tick;
+        next.stopped = killed || (authority.stopped && next.input_seq == authority.input_seq);
+    }
+
+    authority = next;
+}
+
+bool Prediction::predict(Clock::time_point now, double server_offset_s, double rtt_s, float& x, float& y) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (authority.version == 0) {
+        return false;
+    }
+
+    const double now_s = seconds(now);
+
+    if (applied.version != authority.version) {
+        // keep showing where the ship was, the difference to the new prediction is blended out below
+        if (applied.version > 0) {
+            float old_x, old_y, new_x, new_y;
+            replay(applied, now_s, server_offset_s, rtt_s, old_x, old_y);
+            replay(authority, now_s, server_offset_s, rtt_s, new_x, new_y);
+            error_x += old_x - new_x;
+            error_y += old_y - new_y;
+            if (std::hypot(error_x, error_y) > SNAP_DISTANCE) {
+                error_x = error_y = 0;
+            }
+        }
+        applied = authority;
+
+        // only the newest applied input is still needed, for its velocity
+        while (inputs.size() > 1 && seqAtOrBefore(inputs[1].seq, applied.input_seq)) {
+            inputs.pop_front();
+        }
+    }
+
+    replay(applied, now_s, server_offset_s, rtt_s, x, y);
+
+    const double decay = std::exp(-std::fmax(0.0, now_s - last_predict_s) * 1000.0 / SMOOTHING_MS);
+    error_x *= (float)decay;
+    error_y *= (float)decay;
+    last_predict_s = now_s;
+
+    x += error_x;
+    y += error_y;
+    return true;
+}
+
+void Prediction::replay(const Authority& from, double until_s, double server_offset_s, double rtt_s, float& x, float& y) {
+    x = from.x;
+    y = from.y;
+
+    // Inputs sent at local time t reach the server around t + server_offset_s + rtt_s
+    double t = (double)from.tick / SERVER_TICK_RATE - server_offset_s - rtt_s;
+    t = std::fmax(t, until_s - MAX_REPLAY_S);
+
+    // Velocity at the snapshot, from the newest input the server applied
+    float vx = 0, vy = 0;
+    size_t i = 0;
+    for (; i < inputs.size() && from.input_seq != 0 && seqAtOrBefore(inputs[i].seq, from.input_seq); i++) {
+        vx = inputs[i].vx;
+        vy = inputs[i].vy;
+    }
+    if (from.stopped) {
+        vx = vy = 0;
+    }
+
+    // Then the ones it has not applied yet
+    for (; i < inputs.size(); i++) {
+        const Input& input = inputs[i];
+        if (input.sent_s > t) {
+            advance(x, y, vx, vy, std::fmin(input.sent_s, until_s) - t);
+            t = input.sent_s;
+        }
+        vx = input.vx;
+        vy = input.vy;
+    }
+
+    if (until_s > t) {
+        advance(x, y, vx, vy, until_s - t);
+    }
+}
+
+void Prediction::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    inputs.clear();
+    authority = Authority();
+    applied = Authority();
+    error_x = error_y = 0;
+}
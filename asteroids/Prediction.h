@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "SnapshotDecoder.h"
+
+// Moves the own spaceship as soon as an input is made instead of a round trip later.
+// Every SELF_SPACESHIP carries a sequence number and every ALL_ENTITIES tells which one the server
+// applied last. The predicted position is the newest server position with the inputs the server
+// has not applied yet replayed on top, moving like the server does (Game::moveEntities).
+// Corrections are blended in over SMOOTHING_MS instead of snapping the ship.
+class Prediction {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int SERVER_TICK_RATE = 120;        // must match Server::TICK_RATE
+    static constexpr size_t MAX_INPUTS = 1024;          // unapplied inputs kept, the oldest are dropped beyond
+    static constexpr double MAX_REPLAY_S = 1.0;         // longer replays mean the clock estimate is off, they are cut
+    static constexpr double SMOOTHING_MS = 100;
+    static constexpr float SNAP_DISTANCE = 100.f;       // corrections further than this (respawn, new match) are not blended
+
+    // Render thread. Records a SELF_SPACESHIP about to be sent, returns its sequence number
+    static uint32_t record(float vx, float vy, Clock::time_point sent);
+
+    // Broadcast thread. The own spaceship in the newest snapshot and the tick it was taken at
+    static void authoritative(const SnapshotDecoder::Entity& spaceship, uint32_t tick);
+
+    // Render thread. server_offset_s is server time - local time (SnapshotBuffer::clockOffset),
+    // rtt_s the round trip to the server. Returns false until the first snapshot with the own spaceship
+    static bool predict(Clock::time_point now, double server_offset_s, double rtt_s, float& x, float& y);
+
+    static void clear();
+
+private:
+    struct Input {
+        uint32_t seq;
+        double sent_s;
+        float vx, vy;
+    };
+
+    struct Authority {
+        float x{}, y{};
+        uint32_t tick{};
+        uint32_t input_seq{};
+        uint8_t lives{};
+        bool stopped{};         // server zeroed the velocity after input_seq (death, new match)
+        uint64_t version{};
+    };
+
+    // callers hold mutex
+    static void replay(const Authority& from, double until_s, double server_offset_s, double rtt_s, float& x, float& y);
+
+    static std::mutex mutex;
+    static std::deque<Input> inputs;        // newest applied input first, then the unapplied ones
+    static uint32_t next_seq;
+
+    static Authority authority;
+    static Authority applied;               // authority the current correction is based on
+    static float error_x, error_y;          // shown position - predicted position, decays to 0
+    static double last_predict_s;
+};
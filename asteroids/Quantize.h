@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include "Global.h"
+
+// Fixed point encoding of ALL_ENTITIES positions, rotations and asteroid radii.
+// Must match server/quantize.h, which also holds the error bounds. The static_asserts below pin the
+// ranges and steps on both sides.
+struct Quantize {
+    // Asteroids wrap outside the screen, so positions cover twice the screen in each direction
+    static constexpr float POS_X_MIN = -(float)SCREEN_WIDTH;
+    static constexpr float POS_X_MAX = (float)SCREEN_WIDTH;
+    static constexpr float POS_Y_MIN = -(float)SCREEN_HEIGHT;
+    static constexpr float POS_Y_MAX = (float)SCREEN_HEIGHT;
+
+    static constexpr float POS_X_STEP = (POS_X_MAX - POS_X_MIN) / UINT16_MAX;   // ~0.05px
+    static constexpr float POS_Y_STEP = (POS_Y_MAX - POS_Y_MIN) / UINT16_MAX;   // ~0.03px
+    static constexpr float ROTATION_STEP = 360.f / (UINT16_MAX + 1);             // ~0.005 degrees
+
+    static constexpr float posX(uint16_t q) { return POS_X_MIN + q * POS_X_STEP; }
+    static constexpr float posY(uint16_t q) { return POS_Y_MIN + q * POS_Y_STEP; }
+    static constexpr float rotation(uint16_t q) { return q * ROTATION_STEP; }
+    static constexpr float radius(uint8_t q) { return (float)q; }
+};
+
+// The wire format. server/quantize.h pins the same values, change both together
+static_assert(Quantize::POS_X_MIN == -1600.f && Quantize::POS_X_MAX == 1600.f, "x range must match server/quantize.h");
+static_assert(Quantize::POS_Y_MIN == -900.f && Quantize::POS_Y_MAX == 900.f, "y range must match server/quantize.h");
+static_assert(Quantize::ROTATION_STEP == 360.f / 65536 && Quantize::radius((uint8_t)1) == 1.f, "rotation and radius steps must match server/quantize.h");
+
+static_assert(Quantize::posX(0) == Quantize::POS_X_MIN && Quantize::posY(0) == Quantize::POS_Y_MIN, "min positions must be exact");
+static_assert(Quantize::rotation(UINT16_MAX) < 360.f, "rotation wraps at 360 degrees");
@@ -0,0 +1,144 @@
+#include "ReliableSender.h"
+#include "GameLogic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+std::mutex ReliableSender::mutex;
+std::condition_variable ReliableSender::cv;
+bool ReliableSender::running = true;
+std::map<int, ReliableSender::Message> ReliableSender::outstanding;
+std::priority_queue<ReliableSender::Timer, std::vector<ReliableSender::Timer>, std::greater<ReliableSender::Timer>> ReliableSender::timers;
+double ReliableSender::srtt_ms = 0;
+double ReliableSender::rttvar_ms = 0;
+double ReliableSender::rto_ms = ReliableSender::INITIAL_RTO_MS;
+uint64_t ReliableSender::samples = 0;
+uint64_t ReliableSender::retransmits = 0;
+
+void ReliableSender::send(const char* buffer, int length, int seq) {
+    // Registered before it goes out, on a LAN the ack can arrive before sendData returns
+    {
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        outstanding[seq] = { std::vector<char>(buffer, buffer + length), now, 1 };
+        timers.push({ now + retransmitTimeout(1), seq });
+    }
+    cv.notify_one();
+
+    sendData(buffer, length);
+}
+
+void ReliableSender::ack(int seq) {
+    const auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = outstanding.find(seq);
+    if (it == outstanding.end()) {
+        return;
+    }
+
+    // Karn's algorithm, the ack of a retransmitted message could belong to any copy
+    if (it->second.attempts == 1) {
+        addSample(std::chrono::duration<double, std::milli>(now - it->second.first_sent).count());
+    }
+    outstanding.erase(it);
+}
+
+void ReliableSender::sample(double rtt_ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    addSample(rtt_ms);
+}
+
+void ReliableSender::addSample(double rtt_ms) {
+    constexpr double ALPHA = 1.0 / 8;
+    constexpr double BETA = 1.0 / 4;
+    constexpr double K = 4;
+    constexpr double G_MS = 1;  // clock granularity
+
+    if (samples++ == 0) {
+        srtt_ms = rtt_ms;
+        rttvar_ms = rtt_ms / 2;
+    }
+    else {
+        rttvar_ms = (1 - BETA) * rttvar_ms + BETA * std::abs(srtt_ms - rtt_ms);
+        srtt_ms = (1 - ALPHA) * srtt_ms + ALPHA * rtt_ms;
+    }
+
+    rto_ms = srtt_ms + std::max(G_MS, K * rttvar_ms);
+    rto_ms = std::min(std::max(rto_ms, MIN_RTO_MS), MAX_RTO_MS);
+}
+
+ReliableSender::Clock::duration ReliableSender::retransmitTimeout(int attempts) {
+    double timeout_ms = rto_ms;
+    for (int i = 1; i < attempts && timeout_ms < MAX_RTO_MS; i++) {
+        timeout_ms *= 2;
+    }
+    timeout_ms = std::min(timeout_ms, MAX_RTO_MS);
+
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(timeout_ms));
+}
+
+void ReliableSender::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running) {
+        if (timers.empty()) {
+            cv.wait(lock);
+            continue;
+        }
+
+        const Timer timer = timers.top();
+        const auto now = Clock::now();
+
+        if (timer.first > now) {
+            cv.wait_until(lock, timer.first);
+            continue;
+        }
+        timers.pop();
+
+        auto it = outstanding.find(timer.second);
+        if (it == outstanding.end()) {
+            // has been acked
+            continue;
+        }
+
+        if (now - it->second.first_sent >= std::chrono::milliseconds(GIVE_UP_MS)) {
+            outstanding.erase(it);
+            std::cerr << "Server did not send ACK_NEW_BULLET for seq " << timer.second << "!" << std::endl;
+            continue;
+        }
+
+        it->second.attempts++;
+        retransmits++;
+        sendData(it->second.buffer);
+        timers.push({ now + retransmitTimeout(it->second.attempts), timer.second });
+    }
+}
+
+void ReliableSender::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cv.notify_one();
+}
+
+double ReliableSender::srtt() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return srtt_ms;
+}
+
+double ReliableSender::rto() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rto_ms;
+}
+
+void ReliableSender::printStats(std::ostream& os) {
+    std::lock_guard<std::mutex> lock(mutex);
+    os << std::fixed << std::setprecision(1)
+        << "Server srtt=" << srtt_ms << "ms rttvar=" << rttvar_ms << "ms rto=" << rto_ms << "ms"
+        << std::defaultfloat
+        << " (" << samples << " samples, " << retransmits << " retransmits)" << std::endl;
+}
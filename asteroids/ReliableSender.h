@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+
+// Retransmits reliable client messages (NEW_BULLET) until the server acks their sequence number.
+// All outstanding messages share one retransmit thread (run).
+//
+// The retransmission timeout follows RFC 6298: smoothed RTT and RTT variance are updated from
+// acks of messages that were only sent once, and every retransmission of a message doubles its timeout.
+class ReliableSender {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double INITIAL_RTO_MS = 200;
+    static constexpr double MIN_RTO_MS = 20;
+    static constexpr double MAX_RTO_MS = 2000;
+    static constexpr int GIVE_UP_MS = 5000;     // stop retransmitting a message this long after it was first sent
+
+    // Sends buffer now and retransmits a copy of it until ack(seq) or GIVE_UP_MS
+    static void send(const char* buffer, int length, int seq);
+
+    static void ack(int seq);
+
+    // Feeds a round trip measured outside of send/ack, e.g. the connection handshake
+    static void sample(double rtt_ms);
+
+    // Retransmit loop, run on its own thread
+    static void run();
+
+    static void stop();
+
+    static double srtt();
+    static double rto();
+
+    static void printStats(std::ostream& os);
+
+private:
+    struct Message {
+        std::vector<char> buffer;
+        Clock::time_point first_sent;
+        int attempts;
+    };
+
+    // callers hold mutex
+    static void addSample(double rtt_ms);
+    static Clock::duration retransmitTimeout(int attempts);
+
+    static std::mutex mutex;
+    static std::condition_variable cv;
+    static bool running;
+
+    static std::map<int, Message> outstanding;      // by seq
+
+    // retransmit deadlines, entries of acked messages are skipped when popped
+    using Timer = std::pair<Clock::time_point, int>;
+    static std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+
+    // rtt estimate of the server
+    static double srtt_ms;
+    static double rttvar_ms;
+    static double rto_ms;
+    static uint64_t samples;
+    static uint64_t retransmits;
+};
@@ -0,0 +1,259 @@
+#include "SnapshotBuffer.h"
+#include "Global.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+std::mutex SnapshotBuffer::mutex;
+std::array<SnapshotBuffer::Frame, SnapshotBuffer::CAPACITY> SnapshotBuffer::frames{};
+int SnapshotBuffer::head = 0;
+int SnapshotBuffer::count = 0;
+double SnapshotBuffer::clock_offset = 0;
+double SnapshotBuffer::render_offset = 0;
+double SnapshotBuffer::last_sample_s = 0;
+double SnapshotBuffer::delay_s = SnapshotBuffer::DEFAULT_DELAY_MS / 1000.0;
+
+namespace {
+    // How fast the clock offset follows snapshots that arrive later than the earliest ones,
+    // slow enough to ignore jitter and fast enough to follow clock drift
+    constexpr double OFFSET_DECAY = 0.01;
+
+    // Rendered time runs at most this much faster or slower than real time while catching up with the offset
+    constexpr double MAX_SLEW = 0.05;
+
+    double seconds(SnapshotBuffer::Clock::time_point t) {
+        return std::chrono::duration<double>(t.time_since_epoch()).count();
+    }
+
+    // Entities that moved further than this between two snapshots wrapped around the screen
+    // and are not interpolated across it
+    bool wrapped(const SnapshotDecoder::Entity& a, const SnapshotDecoder::Entity& b) {
+        return std::fabs(b.x - a.x) > SCREEN_WIDTH / 2.f || std::fabs(b.y - a.y) > SCREEN_HEIGHT / 2.f;
+    }
+
+    // Degrees, along the shorter way around
+    float lerpAngle(float from, float to, float t) {
+        float diff = std::fmod(to - from + 540.f, 360.f) - 180.f;
+        return std::fmod(from + diff * t + 360.f, 360.f);
+    }
+}
+
+void SnapshotBuffer::push(const SnapshotDecoder::State& snapshot, Clock::time_point received) {
+    const double server_time = (double)snapshot.tick / SERVER_TICK_RATE;
+    const double offset = server_time - seconds(received);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (count > 0 && std::fabs(offset - clock_offset) > RESYNC_MS / 1000.0) {
+        // New match or a long stall, the buffered snapshots are on another timeline
+        count = 0;
+    }
+
+    if (count == 0) {
+        clock_offset = offset;
+        render_offset = offset;
+    }
+    else {
+        if (server_time <= frame(count - 1).server_time) {
+            return;
+        }
+
+        // Late snapshots only pull the offset down slowly, so jitter does not move the render time
+        clock_offset = offset > clock_offset ? offset : clock_offset + (offset - clock_offset) * OFFSET_DECAY;
+    }
+
+    if (count == CAPACITY) {
+        head = (head + 1) % CAPACITY;
+        count--;
+    }
+
+    Frame& f = frames[(head + count) % CAPACITY];
+    f.server_time = server_time;
+    f.state.seq = snapshot.seq;
+    f.state.tick = snapshot.tick;
+    f.state.spaceships.assign(snapshot.spaceships.begin(), snapshot.spaceships.end());
+    f.state.bullets.assign(snapshot.bullets.begin(), snapshot.bullets.end());
+    f.state.asteroids.assign(snapshot.asteroids.begin(), snapshot.asteroids.end());
+    count++;
+}
+
+bool SnapshotBuffer::sample(Clock::time_point now, SnapshotDecoder::State& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (count == 0) {
+        return false;
+    }
+
+    const double now_s = seconds(now);
+    const double max_slew = std::fabs(now_s - last_sample_s) * MAX_SLEW;
+    render_offset += std::fmax(-max_slew, std::fmin(max_slew, clock_offset - render_offset));
+    last_sample_s = now_s;
+
+    const double render_time = now_s + render_offset - delay_s;
+
+    // Newest frame at or before the render time
+    int from = -1;
+    while (from + 1 < count && frame(from + 1).server_time <= render_time) {
+        from++;
+    }
+
+    if (from < 0 || from == count - 1) {
+        // Before the oldest frame, or starved because snapshots stopped coming. Hold, no extrapolation
+        const Frame& f = frame(from < 0 ? 0 : from);
+        out.seq = f.state.seq;
+        out.tick = f.state.tick;
+        out.spaceships.assign(f.state.spaceships.begin(), f.state.spaceships.end());
+        out.bullets.assign(f.state.bullets.begin(), f.state.bullets.end());
+        out.asteroids.assign(f.state.asteroids.begin(), f.state.asteroids.end());
+        return true;
+    }
+
+    const Frame& a = frame(from);
+    const Frame& b = frame(from + 1);
+    const float t = (float)((render_time - a.server_time) / (b.server_time - a.server_time));
+
+    out.seq = b.state.seq;
+    out.tick = b.state.tick;
+    interpolate(a.state.spaceships, b.state.spaceships, t, out.spaceships);
+    interpolate(a.state.bullets, b.state.bullets, t, out.bullets);
+    interpolate(a.state.asteroids, b.state.asteroids, t, out.asteroids);
+    return true;
+}
+
+void SnapshotBuffer::interpolate(const std::vector<SnapshotDecoder::Entity>& from, const std::vector<SnapshotDecoder::Entity>& to,
+    float t, std::vector<SnapshotDecoder::Entity>& out) {
+    out.clear();
+
+    // Entities of the newer snapshot, those also in the older one are moved back towards it.
+    // Surviving entities keep their order across snapshots, so the match is usually the next one
+    size_t hint = 0;
+    for (const SnapshotDecoder::Entity& e : to) {
+        out.push_back(e);
+
+        size_t j = hint;
+        if (j >= from.size() || from[j].id != e.id) {
+            j = 0;
+            while (j < from.size() && from[j].id != e.id) {
+                j++;
+            }
+        }
+        if (j == from.size()) {
+            // spawned in between
+            continue;
+        }
+        hint = j + 1;
+
+        const SnapshotDecoder::Entity& p = from[j];
+        SnapshotDecoder::Entity& r = out.back();
+        r.rotation = lerpAngle(p.rotation, e.rotation, t);
+        if (wrapped(p, e)) {
+            // already on the other side, only the rotation is interpolated
+            continue;
+        }
+
+        r.x = p.x + (e.x - p.x) * t;
+        r.y = p.y + (e.y - p.y) * t;
+    }
+}
+
+void SnapshotBuffer::setDelay(double ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    delay_s = ms / 1000.0;
+}
+
+double SnapshotBuffer::delay() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return delay_s * 1000.0;
+}
+
+double SnapshotBuffer::clockOffset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return clock_offset;
+}
+
+void SnapshotBuffer::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    count = 0;
+}
+
+bool SnapshotBuffer::selfCheck(std::ostream& os) {
+    // One asteroid moving 240 px/s right and spinning 90 degrees/s, wrapping at the right edge.
+    // Snapshots every 4 ticks arrive 20-40ms after they were taken, some out of order
+    constexpr double SPEED = 240, SPIN = 90, FRAME = 1 / 144.0;
+    struct Arrival {
+        double at;
+        SnapshotDecoder::State state;
+    };
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> jitter(0, 0.02);
+    std::vector<Arrival> arrivals;
+    for (uint32_t k = 0; k < 300; k++) {
+        const uint32_t tick = k * 4;
+        const double t = (double)tick / SERVER_TICK_RATE;
+
+        Arrival a;
+        a.at = t + 0.02 + jitter(rng);
+        a.state.seq = k + 1;
+        a.state.tick = tick;
+        SnapshotDecoder::Entity e;
+        e.id = 7;
+        e.x = (float)std::fmod(100 + SPEED * t, SCREEN_WIDTH);
+        e.y = 300;
+        e.rotation = (float)std::fmod(350 + SPIN * t, 360);
+        a.state.asteroids.push_back(e);
+        arrivals.push_back(a);
+    }
+    std::sort(arrivals.begin(), arrivals.end(), [](const Arrival& a, const Arrival& b) { return a.at < b.at; });
+
+    clear();
+    setDelay(DEFAULT_DELAY_MS);
+
+    const Clock::time_point start = Clock::now();
+    auto at = [start](double s) { return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s)); };
+
+    size_t next = 0;
+    int frames = 0, wraps = 0;
+    double max_step = 0, max_turn = 0;
+    float last_x = -1, last_rotation = 0;
+    SnapshotDecoder::State out;
+    for (double t = 0; t < 9.5; t += FRAME) {
+        while (next < arrivals.size() && arrivals[next].at <= t) {
+            push(arrivals[next].state, at(arrivals[next].at));
+            next++;
+        }
+        if (!sample(at(t), out) || out.asteroids.empty()) {
+            continue;
+        }
+
+        const SnapshotDecoder::Entity& e = out.asteroids[0];
+        if (last_x >= 0) {
+            const double step = e.x - last_x;
+            if (step < -SCREEN_WIDTH / 2.0) {
+                wraps++;
+            }
+            else {
+                max_step = std::max(max_step, std::fabs(step));
+            }
+            max_turn = std::max(max_turn, std::fabs(std::fmod(e.rotation - last_rotation + 540.0, 360.0) - 180.0));
+        }
+        last_x = e.x;
+        last_rotation = e.rotation;
+        frames++;
+    }
+    clear();
+
+    // Wraps once at 6.25s, no frame moves or turns much more than real time allows
+    const double ideal_step = SPEED * FRAME, ideal_turn = SPIN * FRAME;
+    const bool ok = frames > 1300 && wraps == 1 && max_step < 1.5 * ideal_step && max_turn < 1.5 * ideal_turn;
+
+    os << "snapshot buffer self check, 30 Hz snapshots with 20ms jitter rendered at 144 Hz" << std::endl;
+    os << "\tframes " << frames << ", wraps " << wraps
+        << ", max step " << max_step << "px (ideal " << ideal_step << "), max turn " << max_turn << " deg (ideal " << ideal_turn << ")"
+        << (ok ? "" : " FAILED") << std::endl;
+    return ok;
+}
+
+const SnapshotBuffer::Frame& SnapshotBuffer::frame(int i) {
+    return frames[(head + i) % CAPACITY];
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include "SnapshotDecoder.h"
+
+// Keeps the newest decoded ALL_ENTITIES snapshots with the server time they were taken at, and
+// renders entities a fixed delay behind the server, interpolated between the two snapshots around
+// that time. A snapshot that arrives late or not at all is covered by the delay instead of showing
+// up as stutter, which is what lets the server send snapshots at 30 Hz instead of every tick.
+class SnapshotBuffer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int SERVER_TICK_RATE = 120;        // must match Server::TICK_RATE
+    static constexpr int CAPACITY = 16;                 // ~0.5s at 30 Hz
+    static constexpr double DEFAULT_DELAY_MS = 100;     // 3 snapshot intervals at 30 Hz
+    static constexpr double RESYNC_MS = 500;            // server clock jumps beyond this restart the buffer, e.g. a new match
+
+    // Broadcast thread. Snapshots older than the newest one are ignored
+    static void push(const SnapshotDecoder::State& snapshot, Clock::time_point received);
+
+    // Render thread. Fills out with the entities at now - delay.
+    // Returns false until the first snapshot arrived
+    static bool sample(Clock::time_point now, SnapshotDecoder::State& out);
+
+    static void setDelay(double ms);
+    static double delay();
+
+    // Server time - local time in seconds, from the earliest arriving snapshots
+    static double clockOffset();
+
+    static void clear();
+
+    // Plays 10s of snapshots with jitter through the buffer and checks the rendered motion is smooth.
+    // Clears the buffer, run it before connecting
+    static bool selfCheck(std::ostream& os);
+
+private:
+    struct Frame {
+        double server_time{};   // seconds, from the snapshot tick
+        SnapshotDecoder::State state;
+    };
+
+    // callers hold mutex
+    static const Frame& frame(int i);   // 0 is the oldest
+    static void interpolate(const std::vector<SnapshotDecoder::Entity>& from, const std::vector<SnapshotDecoder::Entity>& to,
+        float t, std::vector<SnapshotDecoder::Entity>& out);
+
+    static std::mutex mutex;
+    static std::array<Frame, CAPACITY> frames;  // ring, states keep their capacity
+    static int head;                            // oldest frame
+    static int count;
+
+    // server time - local time, from the earliest arriving snapshots
+    static double clock_offset;
+
+    // clock_offset as used for rendering, follows it at a bounded rate so the rendered time never jumps
+    static double render_offset;
+    static double last_sample_s;
+
+    static double delay_s;
+};
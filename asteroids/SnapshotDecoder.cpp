@@ -0,0 +1,143 @@
+#include "SnapshotDecoder.h"
+#include "Quantize.h"
+#include "packetbuffer.h"
+
+std::array<SnapshotDecoder::State, SnapshotDecoder::RING_SIZE> SnapshotDecoder::ring{};
+SnapshotDecoder::State SnapshotDecoder::scratch{};
+std::vector<SnapshotDecoder::Entity> SnapshotDecoder::patched{};
+
+const SnapshotDecoder::State* SnapshotDecoder::decode(const char* buffer, int length) {
+    BufferReader reader(buffer, (size_t)length);
+    reader.u8();    // cmd
+    const uint32_t seq = reader.u32();
+    const uint32_t baseline_seq = reader.u32();
+    const uint32_t tick = reader.u32();
+    if (!reader.ok() || seq == 0) {
+        return nullptr;
+    }
+
+    State& slot = ring[seq % RING_SIZE];
+    if (slot.seq == seq) {
+        // duplicate
+        return &slot;
+    }
+
+    scratch.seq = seq;
+    scratch.tick = tick;
+    scratch.spaceships.clear();
+    scratch.bullets.clear();
+    scratch.asteroids.clear();
+
+    if (baseline_seq == 0) {
+        if (!readFull(reader, SPACESHIPS, scratch.spaceships)
+            || !readFull(reader, BULLETS, scratch.bullets)
+            || !readFull(reader, ASTEROIDS, scratch.asteroids)) {
+            return nullptr;
+        }
+    }
+    else {
+        const State& baseline = ring[baseline_seq % RING_SIZE];
+        if (baseline.seq != baseline_seq || baseline_seq >= seq || seq - baseline_seq >= RING_SIZE) {
+            // never received or already overwritten, wait for a snapshot against a newer baseline
+            return nullptr;
+        }
+
+        if (!readDelta(reader, SPACESHIPS, baseline.spaceships, scratch.spaceships)
+            || !readDelta(reader, BULLETS, baseline.bullets, scratch.bullets)
+            || !readDelta(reader, ASTEROIDS, baseline.asteroids, scratch.asteroids)) {
+            return nullptr;
+        }
+    }
+
+    std::swap(slot, scratch);
+    return &slot;
+}
+
+bool SnapshotDecoder::readFull(BufferReader& reader, Category category, std::vector<Entity>& out) {
+    int count = reader.u8();
+    for (int i = 0; i < count && reader.ok(); i++) {
+        Entity e;
+        e.id = reader.u32();
+        switch (category) {
+        case SPACESHIPS:
+            e.sid = reader.u8();
+            e.x = Quantize::posX(reader.u16());
+            e.y = Quantize::posY(reader.u16());
+            e.rotation = Quantize::rotation(reader.u16());
+            e.lives = reader.u8();
+            e.score = reader.u8();
+            e.input_seq = reader.u32();
+            break;
+        case BULLETS:
+            e.sid = reader.u8();
+            e.x = Quantize::posX(reader.u16());
+            e.y = Quantize::posY(reader.u16());
+            break;
+        case ASTEROIDS:
+            e.x = Quantize::posX(reader.u16());
+            e.y = Quantize::posY(reader.u16());
+            e.radius = Quantize::radius(reader.u8());
+            break;
+        }
+        out.push_back(e);
+    }
+    return reader.ok();
+}
+
+bool SnapshotDecoder::readDelta(BufferReader& reader, Category category, const std::vector<Entity>& baseline, std::vector<Entity>& out) {
+    const int n = (int)baseline.size();
+
+    // Removed, 1 bit per baseline entity
+    const int removed_bytes = (n + 7) / 8;
+    const char* removed = reader.bytes(removed_bytes);
+    if (!removed) {
+        return false;
+    }
+
+    // Changed, baseline index - field mask - fields
+    patched = baseline;
+
+    int num_changed = reader.u8();
+    for (int i = 0; i < num_changed && reader.ok(); i++) {
+        int index = reader.u8();
+        uint8_t mask = reader.u8();
+        if (index >= n) {
+            return false;
+        }
+
+        const Entity& b = baseline[index];
+        Entity& e = patched[index];
+
+        // Must match the server, which keeps the reconstructed values as the next baseline
+        if (mask & FIELD_X) {
+            e.x = (mask & FIELD_SMALL_POS) ? b.x + (float)reader.i8() / POS_DELTA_SCALE : Quantize::posX(reader.u16());
+        }
+        if (mask & FIELD_Y) {
+            e.y = (mask & FIELD_SMALL_POS) ? b.y + (float)reader.i8() / POS_DELTA_SCALE : Quantize::posY(reader.u16());
+        }
+        if (mask & FIELD_ROTATION) {
+            e.rotation = Quantize::rotation(reader.u16());
+        }
+        if (mask & FIELD_LIVES) {
+            e.lives = reader.u8();
+        }
+        if (mask & FIELD_SCORE) {
+            e.score = reader.u8();
+        }
+        if (mask & FIELD_INPUT_SEQ) {
+            e.input_seq = reader.u32();
+        }
+    }
+    if (!reader.ok()) {
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!(removed[i / 8] & (1 << (i % 8)))) {
+            out.push_back(patched[i]);
+        }
+    }
+
+    // Added, full entities after the remaining baseline entities
+    return readFull(reader, category, out);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class BufferReader;
+
+// Rebuilds ALL_ENTITIES snapshots sent by the server (server/snapshot.cpp).
+// A snapshot is either full or a delta against an earlier snapshot (its baseline) that this
+// client has acked with ACK_ALL_ENTITIES. Decoded snapshots are kept in a ring so that later
+// deltas can refer to them. Positions, rotations and radii are fixed point (Quantize.h).
+class SnapshotDecoder {
+public:
+    static constexpr int RING_SIZE = 32;
+    static constexpr float POS_DELTA_SCALE = 16.f;  // position deltas are in 1/16 px
+
+    // Field mask of a changed entity in a delta snapshot
+    enum Fields : uint8_t {
+        FIELD_X = 1 << 0,
+        FIELD_Y = 1 << 1,
+        FIELD_SMALL_POS = 1 << 2,   // x and y are int8 deltas instead of 16 bit positions
+        FIELD_ROTATION = 1 << 3,
+        FIELD_LIVES = 1 << 4,
+        FIELD_SCORE = 1 << 5,
+        FIELD_INPUT_SEQ = 1 << 6,
+    };
+
+    struct Entity {
+        uint32_t id{};      // stable across snapshots, slot in the low 16 bits and generation in the high 16 bits
+        uint8_t sid{};
+        float x{}, y{};
+        float rotation{};   // spaceships
+        float radius{};     // asteroids
+        uint8_t lives{}, score{};
+        uint32_t input_seq{};   // spaceships, newest SELF_SPACESHIP the server applied
+    };
+
+    struct State {
+        uint32_t seq{};
+        uint32_t tick{};    // server tick the snapshot was taken at
+        std::vector<Entity> spaceships;
+        std::vector<Entity> bullets;
+        std::vector<Entity> asteroids;
+    };
+
+    // Decodes an ALL_ENTITIES packet, starting at the cmd byte.
+    // Returns nullptr if the packet is malformed or its baseline is no longer in the ring.
+    static const State* decode(const char* buffer, int length);
+
+private:
+    enum Category {
+        SPACESHIPS,
+        BULLETS,
+        ASTEROIDS,
+    };
+
+    // Both append to out
+    static bool readFull(BufferReader& reader, Category category, std::vector<Entity>& out);
+    static bool readDelta(BufferReader& reader, Category category, const std::vector<Entity>& baseline, std::vector<Entity>& out);
+
+    static std::array<State, RING_SIZE> ring;   // indexed by seq % RING_SIZE
+    static State scratch;                       // decoded into, swapped into the ring on success
+    static std::vector<Entity> patched;         // baseline with changes applied, reused between decodes
+};
@@ -1,17 +1,31 @@
 ﻿#include <SFML/Graphics.hpp>
 #include <iostream>
 #include "GameLogic.h"
+#include "SnapshotBuffer.h"
+#include "EntityPool.h"
+#include "AsteroidShapes.h"
+#include "BatchRenderer.h"
+#include <cstring>
 
 
-int main()
+int main(int argc, char** argv)
 {
+    // asteroids --selfcheck: checks interpolation, the entity pools and geometry building, no window or server needed
+    if (argc > 1 && std::strcmp(argv[1], "--selfcheck") == 0) {
+        bool ok = SnapshotBuffer::selfCheck(std::cout);
+        ok = entityPoolSelfCheck(std::cout) && ok;
+        ok = AsteroidShapes::selfCheck(std::cout) && ok;
+        ok = BatchRenderer::selfCheck(std::cout) && ok;
+        std::cout << (ok ? "all self checks passed" : "SELF CHECK FAILED") << std::endl;
+        return ok ? 0 : 1;
+    }
+
     // Create a window with 1600x900 resolution
     sf::RenderWindow window(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), "Asteroids", sf::Style::Close | sf::Style::Titlebar);
     sf::Clock clock;
     std::cout << "SFML Window Created Successfully!\n";
 
     GameLogic::init();
-    std::thread t(Global::threadpoolManager);
 
     // Main loop
     while (window.isOpen())
@@ -32,7 +46,6 @@ int main()
     }
 
     closeNetwork();
-    t.join();
 
     std::cout << "SFML Window Closed.\n";
     return 0;
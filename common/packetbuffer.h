@@ -0,0 +1,185 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file packetbuffer.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the big endian packet writer and reader shared by the
+server and the client
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __PACKETBUFFER_H__
+#define __PACKETBUFFER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if __has_include(<bit>)
+#include <bit>
+#endif
+
+/**
+ * float <-> its ieee 754 bits, std::bit_cast where the standard library has it.
+ */
+#if defined(__cpp_lib_bit_cast)
+inline uint32_t floatBits(float f) { return std::bit_cast<uint32_t>(f); }
+inline float bitsFloat(uint32_t u) { return std::bit_cast<float>(u); }
+#else
+inline uint32_t floatBits(float f) {
+	uint32_t u;
+	std::memcpy(&u, &f, sizeof(u));
+	return u;
+}
+inline float bitsFloat(uint32_t u) {
+	float f;
+	std::memcpy(&f, &u, sizeof(f));
+	return f;
+}
+#endif
+
+/**
+ * writes big endian values into a caller owned buffer, never allocates.
+ *
+ * writing past the capacity writes nothing and makes ok() false for good, so a message
+ * is written first and checked once at the end.
+ */
+class BufferWriter {
+public:
+	BufferWriter(char* data, size_t capacity) : buf{ data }, capacity{ capacity } {}
+
+	template <size_t N>
+	explicit BufferWriter(char (&data)[N]) : BufferWriter(data, N) {}
+
+	void u8(uint8_t v) {
+		if (has(1)) {
+			buf[offset++] = (char)v;
+		}
+	}
+
+	void u16(uint16_t v) {
+		if (has(2)) {
+			buf[offset++] = (char)(v >> 8);
+			buf[offset++] = (char)v;
+		}
+	}
+
+	void u32(uint32_t v) {
+		if (has(4)) {
+			buf[offset++] = (char)(v >> 24);
+			buf[offset++] = (char)(v >> 16);
+			buf[offset++] = (char)(v >> 8);
+			buf[offset++] = (char)v;
+		}
+	}
+
+	void f32(float v) { u32(floatBits(v)); }
+
+	void bytes(const char* src, size_t n) {
+		if (has(n)) {
+			std::memcpy(buf + offset, src, n);
+			offset += n;
+		}
+	}
+
+	/**
+	 * overwrites a byte already written, for a count only known after the records it counts.
+	 *
+	 * \param pos where the placeholder was written, size() before writing it
+	 * \param v
+	 */
+	void patchU8(size_t pos, uint8_t v) {
+		good = good && pos < offset;
+		if (good) {
+			buf[pos] = (char)v;
+		}
+	}
+
+	const char* data() const { return buf; }
+	size_t size() const { return offset; }
+	bool ok() const { return good; }
+
+private:
+	bool has(size_t n) {
+		good = good && n <= capacity - offset;
+		return good;
+	}
+
+	char* buf;
+	size_t capacity;
+	size_t offset{};
+	bool good = true;
+};
+
+/**
+ * reads big endian values out of a received packet, never allocates.
+ *
+ * reading past the end returns 0 and makes ok() false for good, so a message is read
+ * first and checked once before anything is applied.
+ */
+class BufferReader {
+public:
+	BufferReader(const char* data, size_t length) : buf{ data }, length{ length } {}
+
+	uint8_t u8() {
+		return has(1) ? (uint8_t)buf[offset++] : 0;
+	}
+
+	int8_t i8() {
+		return (int8_t)u8();
+	}
+
+	uint16_t u16() {
+		if (!has(2)) return 0;
+		const uint16_t v = (uint16_t)((uint8_t)buf[offset] << 8 | (uint8_t)buf[offset + 1]);
+		offset += 2;
+		return v;
+	}
+
+	uint32_t u32() {
+		if (!has(4)) return 0;
+		const uint32_t v = (uint32_t)(uint8_t)buf[offset] << 24 | (uint32_t)(uint8_t)buf[offset + 1] << 16
+			| (uint32_t)(uint8_t)buf[offset + 2] << 8 | (uint32_t)(uint8_t)buf[offset + 3];
+		offset += 4;
+		return v;
+	}
+
+	float f32() { return bitsFloat(u32()); }
+
+	/**
+	 * \param n
+	 * \return the next n bytes, in place. nullptr if there are fewer left
+	 */
+	const char* bytes(size_t n) {
+		if (!has(n)) return nullptr;
+		const char* p = buf + offset;
+		offset += n;
+		return p;
+	}
+
+	size_t position() const { return offset; }
+	size_t remaining() const { return length - offset; }
+	bool ok() const { return good; }
+
+private:
+	bool has(size_t n) {
+		good = good && n <= length - offset;
+		return good;
+	}
+
+	const char* buf;
+	size_t length;
+	size_t offset{};
+	bool good = true;
+};
+
+#endif // __PACKETBUFFER_H__
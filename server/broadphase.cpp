@@ -0,0 +1,130 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file broadphase.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the uniform grid broadphase for collision checks
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "broadphase.h"
+#include "game.h"
+
+#include <cmath>
+#include <iomanip>
+#include <random>
+
+SpatialHash::SpatialHash(float min_x, float min_y, float width, float height, float cell_size)
+	: min_x{ min_x }, min_y{ min_y },
+	cols{ std::max(1, (int)std::ceil(width / cell_size)) },
+	rows{ std::max(1, (int)std::ceil(height / cell_size)) },
+	inv_cell_w{ cols / width },
+	inv_cell_h{ rows / height },
+	cell_start((size_t)cols * rows + 1, 0) {
+}
+
+void SpatialHash::clear() {
+	items.clear();
+}
+
+void SpatialHash::insert(uint32_t index, float x, float y, float radius) {
+	Item item{};
+	item.index = index;
+	cellRange(x - radius, x + radius, min_x, inv_cell_w, cols, item.cx0, item.cx1);
+	cellRange(y - radius, y + radius, min_y, inv_cell_h, rows, item.cy0, item.cy1);
+	items.push_back(item);
+}
+
+void SpatialHash::build() {
+	// counting sort of items into cells
+	std::fill(cell_start.begin(), cell_start.end(), 0);
+	for (const Item& item : items) {
+		forEachCell(item, [this](int cell) { cell_start[cell + 1]++; });
+	}
+	for (size_t c = 1; c < cell_start.size(); c++) {
+		cell_start[c] += cell_start[c - 1];
+	}
+
+	entries.resize(cell_start.back());
+	std::vector<uint32_t>& next = visited;		// reused as the write cursor of each cell
+	next.assign(cell_start.begin(), cell_start.end() - 1);
+	for (uint32_t i{}; i < (uint32_t)items.size(); i++) {
+		forEachCell(items[i], [this, &next, i](int cell) { entries[next[cell]++] = i; });
+	}
+
+	visited.assign(items.size(), 0);
+	query_stamp = 0;
+}
+
+void SpatialHash::cellRange(float lo, float hi, float min, float inv_cell_size, int cells, int& c0, int& c1) {
+	c0 = (int)std::floor((lo - min) * inv_cell_size);
+	c1 = (int)std::floor((hi - min) * inv_cell_size);
+	if (c1 - c0 >= cells) {
+		c1 = c0 + cells - 1;
+	}
+}
+
+void SpatialHash::benchmark(std::ostream& os) {
+	const float world_w = 2.f * Game::WINDOW_WIDTH;
+	const float world_h = 2.f * Game::WINDOW_HEIGHT;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> pos_x(-(float)Game::WINDOW_WIDTH, (float)Game::WINDOW_WIDTH);
+	std::uniform_real_distribution<float> pos_y(-(float)Game::WINDOW_HEIGHT, (float)Game::WINDOW_HEIGHT);
+	std::uniform_real_distribution<float> radius((float)Game::MIN_ASTEROID_RADIUS, (float)Game::MAX_ASTEROID_RADIUS);
+
+	SpatialHash grid(-(float)Game::WINDOW_WIDTH, -(float)Game::WINDOW_HEIGHT, world_w, world_h, 2.f * Game::MAX_ASTEROID_RADIUS);
+
+	os << "broadphase benchmark, half asteroids and half bullets, time per tick" << std::endl;
+
+	for (int n : { 10, 100, 1000, 10000 }) {
+		std::vector<Game::Circle> asteroids, bullets;
+		for (int i{}; i < n / 2; i++) {
+			asteroids.push_back({ { pos_x(rng), pos_y(rng) }, radius(rng) });
+			bullets.push_back({ { pos_x(rng), pos_y(rng) }, Game::BULLET_RADIUS });
+		}
+
+		// enough repetitions for a stable batch
+		const int reps = std::max(1, 20000 / n);
+
+		size_t brute_pairs{};
+		const double brute_us = bestOf(reps, [&]() {
+			brute_pairs = 0;
+			for (const Game::Circle& a : asteroids) {
+				for (const Game::Circle& b : bullets) {
+					brute_pairs += Game::circleCollision(a, b);
+				}
+			}
+		});
+
+		size_t grid_pairs{};
+		const double grid_us = bestOf(reps, [&]() {
+			grid_pairs = 0;
+			grid.clear();
+			for (uint32_t i{}; i < (uint32_t)bullets.size(); i++) {
+				grid.insert(i, bullets[i].pos.x, bullets[i].pos.y, bullets[i].radius);
+			}
+			grid.build();
+			for (const Game::Circle& a : asteroids) {
+				grid.query(a.pos.x, a.pos.y, a.radius, [&](uint32_t i) {
+					grid_pairs += Game::circleCollision(a, bullets[i]);
+				});
+			}
+		});
+
+		os << "n=" << std::setw(5) << n
+			<< std::fixed << std::setprecision(1)
+			<< " brute=" << std::setw(9) << brute_us << "us"
+			<< " grid=" << std::setw(8) << grid_us << "us"
+			<< std::defaultfloat
+			<< " pairs=" << grid_pairs
+			<< (grid_pairs == brute_pairs ? "" : " MISMATCH with brute force") << std::endl;
+	}
+}
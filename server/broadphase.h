@@ -0,0 +1,145 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file broadphase.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the uniform grid broadphase for collision checks
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __BROADPHASE_H__
+#define __BROADPHASE_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * uniform grid over a toroidal world, rebuilt every tick.
+ *
+ * circles are inserted into every cell their bounding box touches. cells wrap around
+ * the world edges, so a circle on one edge is found by queries on the opposite edge.
+ * queries return candidates only, the caller does the narrow phase.
+ *
+ * usage: clear, insert everything, build, then query any number of times.
+ */
+class SpatialHash {
+public:
+	/**
+	 * \param min_x world bounds
+	 * \param min_y
+	 * \param width
+	 * \param height
+	 * \param cell_size should be around the diameter of the largest circle. shrunk so that
+	 *        the cells tile the world exactly, otherwise the wrap would not line up
+	 */
+	SpatialHash(float min_x, float min_y, float width, float height, float cell_size);
+
+	void clear();
+
+	/**
+	 * \param index returned by query, e.g. the index in the caller's container
+	 * \param x
+	 * \param y
+	 * \param radius
+	 */
+	void insert(uint32_t index, float x, float y, float radius);
+
+	// sorts the inserted circles into their cells
+	void build();
+
+	/**
+	 * calls visit(index) once for every circle that shares a cell with the bounding box of the query circle.
+	 *
+	 * \param x
+	 * \param y
+	 * \param radius
+	 * \param visit
+	 */
+	template <typename F>
+	void query(float x, float y, float radius, F&& visit);
+
+	/**
+	 * times brute force and grid pair finding for 10 to 10k circles and checks both find the same pairs.
+	 *
+	 * \param os
+	 */
+	static void benchmark(std::ostream& os);
+
+private:
+	struct Item {
+		uint32_t index;
+		int cx0, cy0, cx1, cy1;		// cell range, not wrapped yet
+	};
+
+	// cell range covered by [lo, hi] along one axis, not wrapped yet
+	static void cellRange(float lo, float hi, float min, float inv_cell_size, int cells, int& c0, int& c1);
+
+	static int wrap(int c, int cells) {
+		c %= cells;
+		return c < 0 ? c + cells : c;
+	}
+
+	template <typename F>
+	void forEachCell(const Item& item, F&& f) const;
+
+	float min_x, min_y;
+	int cols, rows;
+	float inv_cell_w, inv_cell_h;
+
+	std::vector<Item> items;
+	std::vector<uint32_t> cell_start;	// entries of cell c are [cell_start[c], cell_start[c + 1])
+	std::vector<uint32_t> entries;		// item indices sorted by cell
+	std::vector<uint32_t> visited;		// query stamp per item, a circle in several cells is visited once
+	uint32_t query_stamp{};
+};
+
+template <typename F>
+void SpatialHash::forEachCell(const Item& item, F&& f) const {
+	// a circle larger than the world covers every cell once
+	const int nx = std::min(item.cx1 - item.cx0 + 1, cols);
+	const int ny = std::min(item.cy1 - item.cy0 + 1, rows);
+
+	for (int j{}; j < ny; j++) {
+		const int row = wrap(item.cy0 + j, rows) * cols;
+		for (int i{}; i < nx; i++) {
+			f(row + wrap(item.cx0 + i, cols));
+		}
+	}
+}
+
+template <typename F>
+void SpatialHash::query(float x, float y, float radius, F&& visit) {
+	Item q{};
+	cellRange(x - radius, x + radius, min_x, inv_cell_w, cols, q.cx0, q.cx1);
+	cellRange(y - radius, y + radius, min_y, inv_cell_h, rows, q.cy0, q.cy1);
+
+	if (++query_stamp == 0) {
+		// stamp wrapped, forget old stamps
+		std::fill(visited.begin(), visited.end(), 0);
+		query_stamp = 1;
+	}
+
+	forEachCell(q, [this, &visit](int cell) {
+		for (uint32_t e = cell_start[cell]; e < cell_start[cell + 1]; e++) {
+			const uint32_t item = entries[e];
+			if (visited[item] == query_stamp) {
+				continue;
+			}
+			visited[item] = query_stamp;
+			visit(items[item].index);
+		}
+	});
+}
+
+#endif // __BROADPHASE_H__
@@ -0,0 +1,343 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file buffer.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the packet codec benchmark
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "buffer.h"
+#include "server.h"
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+	// heap allocations of the legacy encoding, counted by its containers. the benchmark runs on
+	// one thread and nothing else uses this allocator
+	uint64_t num_allocations{};
+
+	template <typename T>
+	struct CountingAllocator {
+		using value_type = T;
+
+		CountingAllocator() = default;
+		template <typename U>
+		CountingAllocator(const CountingAllocator<U>&) {}
+
+		T* allocate(size_t n) {
+			num_allocations++;
+			return std::allocator<T>().allocate(n);
+		}
+		void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+		template <typename U>
+		bool operator==(const CountingAllocator<U>&) const { return true; }
+		template <typename U>
+		bool operator!=(const CountingAllocator<U>&) const { return false; }
+	};
+
+	using LegacyBuffer = std::vector<char, CountingAllocator<char>>;
+	using LegacyString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+	// the codec has no allocator to count, it only ever touches the caller's buffer
+	static_assert(std::is_trivially_copyable_v<BufferWriter> && std::is_trivially_destructible_v<BufferWriter>
+		&& std::is_trivially_copyable_v<BufferReader> && std::is_trivially_destructible_v<BufferReader>,
+		"BufferWriter and BufferReader must not own memory");
+
+	// the way messages were encoded before BufferWriter, a vector per number
+	template <typename T>
+	LegacyBuffer legacyBytes(T num) {
+		LegacyBuffer bytes(sizeof(T));
+		uint32_t int_rep = htonl(floatBits(num));
+		std::memcpy(bytes.data(), &int_rep, sizeof(T));
+		return bytes;
+	}
+
+	float legacyFloat(const LegacyBuffer& bytes) {
+		uint32_t int_rep;
+		std::memcpy(&int_rep, bytes.data(), sizeof(float));
+		return bitsFloat(ntohl(int_rep));
+	}
+}
+
+bool PacketCodec::benchmark(std::ostream& os) {
+	using Clock = std::chrono::steady_clock;
+	constexpr int ITERATIONS = 100000;
+
+	os << "packet codec, encode + decode per message, BufferWriter/BufferReader against a vector per number" << std::endl;
+
+	bool all_match = true;
+
+	// runs test ITERATIONS times, returns legacy allocations per message and ns per message
+	const auto measure = [](auto&& test) {
+		const uint64_t before = num_allocations;
+		const auto start = Clock::now();
+		for (int i{}; i < ITERATIONS; i++) {
+			test(i);
+		}
+		const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS;
+		return std::make_pair((double)(num_allocations - before) / ITERATIONS, ns);
+	};
+
+	const auto report = [&](const char* name, std::pair<double, double> codec, std::pair<double, double> legacy, bool match) {
+		os << std::fixed << std::setprecision(2) << name
+			<< ": codec=" << codec.second << "ns"
+			<< " legacy=" << legacy.second << "ns " << legacy.first << " allocs"
+			<< (match ? "" : " MISMATCH") << std::endl;
+		all_match = all_match && match;
+	};
+
+	// keeps the optimiser from dropping the decoded values
+	volatile float sink{};
+
+	// SELF_SPACESHIP, cmd sid seq vx vy rotation, the most frequent client packet
+	{
+		bool match = true;
+		const auto codec = measure([&](int i) {
+			char buf[Server::MAX_PACKET_SIZE];
+			BufferWriter w(buf);
+			w.u8(Server::SELF_SPACESHIP);
+			w.u8(1);
+			w.u32((uint32_t)i);
+			w.f32((float)i);
+			w.f32(-2.5f);
+			w.f32(90.f);
+
+			BufferReader r(buf, w.size());
+			r.u8();
+			r.u8();
+			const uint32_t seq = r.u32();
+			const float vx = r.f32();
+			const float vy = r.f32();
+			const float rot = r.f32();
+			match = match && r.ok() && seq == (uint32_t)i && vx == (float)i && vy == -2.5f && rot == 90.f;
+			sink = vx + vy + rot;
+		});
+		const auto legacy = measure([&](int i) {
+			LegacyBuffer buf;
+			buf.push_back(Server::SELF_SPACESHIP);
+			buf.push_back(1);
+			const uint32_t seq = htonl((uint32_t)i);
+			buf.insert(buf.end(), (const char*)&seq, (const char*)&seq + sizeof(seq));
+			for (const float f : { (float)i, -2.5f, 90.f }) {
+				LegacyBuffer bytes = legacyBytes(f);
+				buf.insert(buf.end(), bytes.begin(), bytes.end());
+			}
+
+			int idx = 6;
+			LegacyBuffer bytes(buf.data() + idx, buf.data() + idx + sizeof(float));
+			const float vx = legacyFloat(bytes);
+			idx += (int)sizeof(float);
+			bytes.assign(buf.data() + idx, buf.data() + idx + sizeof(float));
+			const float vy = legacyFloat(bytes);
+			idx += (int)sizeof(float);
+			bytes.assign(buf.data() + idx, buf.data() + idx + sizeof(float));
+			const float rot = legacyFloat(bytes);
+			match = match && vx == (float)i && vy == -2.5f && rot == 90.f;
+			sink = vx + vy + rot;
+		});
+		report("SELF_SPACESHIP", codec, legacy, match);
+	}
+
+	// NEW_BULLET and its ack, cmd sid bullet_id px py vx vy -> cmd bullet_id
+	{
+		bool match = true;
+		const auto codec = measure([&](int i) {
+			char buf[Server::MAX_PACKET_SIZE];
+			BufferWriter w(buf);
+			w.u8(Server::NEW_BULLET);
+			w.u8(2);
+			w.u32((uint32_t)i | 0x80000000u);
+			w.f32(1.f);
+			w.f32(2.f);
+			w.f32(3.f);
+			w.f32(4.f);
+
+			BufferReader r(buf, w.size());
+			r.u8();
+			r.u8();
+			const uint32_t bullet_id = r.u32();
+			const float sum = r.f32() + r.f32() + r.f32() + r.f32();
+
+			char ack[5];
+			BufferWriter aw(ack);
+			aw.u8(Server::ACK_NEW_BULLET);
+			aw.u32(bullet_id);
+
+			BufferReader ar(ack, aw.size());
+			ar.u8();
+			match = match && r.ok() && ar.u32() == ((uint32_t)i | 0x80000000u) && sum == 10.f;
+			sink = sum;
+		});
+		const auto legacy = measure([&](int i) {
+			LegacyBuffer buf;
+			buf.push_back(Server::NEW_BULLET);
+			buf.push_back(2);
+			const uint32_t id = htonl((uint32_t)i | 0x80000000u);
+			buf.insert(buf.end(), (const char*)&id, (const char*)&id + sizeof(id));
+			for (const float f : { 1.f, 2.f, 3.f, 4.f }) {
+				LegacyBuffer bytes = legacyBytes(f);
+				buf.insert(buf.end(), bytes.begin(), bytes.end());
+			}
+
+			LegacyBuffer ack;
+			ack.push_back(Server::ACK_NEW_BULLET);
+			ack.insert(ack.end(), buf.begin() + 2, buf.begin() + 6);
+
+			float sum{};
+			for (int idx = 6; idx < 22; idx += (int)sizeof(float)) {
+				LegacyBuffer bytes(buf.data() + idx, buf.data() + idx + sizeof(float));
+				sum += legacyFloat(bytes);
+			}
+			uint32_t acked;
+			std::memcpy(&acked, ack.data() + 1, sizeof(acked));
+			match = match && ntohl(acked) == ((uint32_t)i | 0x80000000u) && sum == 10.f;
+			sink = sum;
+		});
+		report("NEW_BULLET + ack", codec, legacy, match);
+	}
+
+	// CONN_ACCEPTED, cmd seq sid port x y rotation. reliable messages are written into the vector
+	// ReliableSender keeps, here into a stack buffer to show the codec itself does not allocate
+	{
+		bool match = true;
+		const auto codec = measure([&](int i) {
+			char buf[20];
+			BufferWriter w(buf);
+			w.u8(Server::CONN_ACCEPTED);
+			w.u32((uint32_t)i);
+			w.u8(3);
+			w.u16(9000);
+			w.f32(500.f);
+			w.f32(500.f);
+			w.f32(15.1f);
+
+			BufferReader r(buf, w.size());
+			r.u8();
+			const uint32_t seq = r.u32();
+			r.u8();
+			const uint16_t port = r.u16();
+			const float sum = r.f32() + r.f32() + r.f32();
+			match = match && w.ok() && w.size() == sizeof(buf) && r.ok() && seq == (uint32_t)i && port == 9000 && sum == 1015.1f;
+			sink = sum;
+		});
+		const auto legacy = measure([&](int i) {
+			LegacyBuffer buf(20);
+			int idx{};
+			buf[idx++] = Server::CONN_ACCEPTED;
+			const uint32_t seq = htonl((uint32_t)i);
+			std::memcpy(buf.data() + idx, &seq, sizeof(seq));
+			idx += (int)sizeof(seq);
+			buf[idx++] = 3;
+			buf[idx++] = (char)(9000 >> 8);
+			buf[idx++] = (char)(9000 & 0xff);
+			for (const float f : { 500.f, 500.f, 15.1f }) {
+				std::memcpy(buf.data() + idx, legacyBytes(f).data(), sizeof(float));
+				idx += (int)sizeof(float);
+			}
+
+			float sum{};
+			for (idx = 8; idx < 20; idx += (int)sizeof(float)) {
+				sum += legacyFloat(LegacyBuffer(buf.data() + idx, buf.data() + idx + sizeof(float)));
+			}
+			match = match && sum == 1015.1f;
+			sink = sum;
+		});
+		report("CONN_ACCEPTED", codec, legacy, match);
+	}
+
+	// START_GAME and END_GAME share the shape, a count then (byte, name length, name) per player
+	{
+		static const char* const names[] = { "alice", "bob", "charlotte", "dan" };
+		bool match = true;
+		const auto codec = measure([&](int i) {
+			char buf[Server::MAX_PACKET_SIZE];
+			BufferWriter w(buf);
+			w.u8(Server::START_GAME);
+			w.u32((uint32_t)i);
+			w.u8(4);
+			for (int p{}; p < 4; p++) {
+				w.u8((uint8_t)p);
+				w.u8((uint8_t)std::strlen(names[p]));
+				w.bytes(names[p], std::strlen(names[p]));
+			}
+
+			BufferReader r(buf, w.size());
+			r.u8();
+			r.u32();
+			const int num_players = r.u8();
+			size_t name_bytes{};
+			for (int p{}; p < num_players; p++) {
+				r.u8();
+				const uint8_t length = r.u8();
+				const char* name = r.bytes(length);
+				match = match && name && std::memcmp(name, names[p], length) == 0;
+				name_bytes += length;
+			}
+			match = match && r.ok() && r.remaining() == 0 && name_bytes == 20;
+			sink = (float)name_bytes;
+		});
+		const auto legacy = measure([&](int i) {
+			LegacyBuffer buf;
+			buf.push_back(Server::START_GAME);
+			const uint32_t seq = htonl((uint32_t)i);
+			buf.insert(buf.end(), (const char*)&seq, (const char*)&seq + sizeof(seq));
+			buf.push_back(4);
+			for (int p{}; p < 4; p++) {
+				buf.push_back((char)p);
+				buf.push_back((char)std::strlen(names[p]));
+				for (const char* c = names[p]; *c; c++) {
+					buf.push_back(*c);
+				}
+			}
+
+			size_t idx = 6, name_bytes{};
+			for (int p{}; p < buf[5]; p++) {
+				const size_t length = (size_t)buf[idx + 1];
+				const LegacyString name(buf.data() + idx + 2, length);
+				match = match && name == names[p];
+				name_bytes += length;
+				idx += 2 + length;
+			}
+			match = match && name_bytes == 20;
+			sink = (float)name_bytes;
+		});
+		report("START_GAME/END_GAME", codec, legacy, match);
+	}
+
+	// bounds checking, a truncated or oversized message reads and writes nothing past the end
+	{
+		char small[6];
+		BufferWriter w(small);
+		w.u8(Server::NEW_BULLET);
+		w.u32(1);
+		w.f32(1.f);
+		const bool write_stopped = !w.ok() && w.size() == 5;
+
+		BufferReader r(small, w.size());
+		r.u8();
+		r.u32();
+		const float past_end = r.f32();
+		const bool read_stopped = !r.ok() && past_end == 0.f && r.bytes(1) == nullptr;
+
+		os << "bounds: writer " << (write_stopped ? "stops" : "OVERRUNS") << ", reader "
+			<< (read_stopped ? "stops" : "OVERRUNS") << std::endl;
+		all_match = all_match && write_stopped && read_stopped;
+	}
+
+	os << "packet codec: " << (all_match ? "all messages round trip" : "MISMATCH") << std::endl << std::endl;
+	(void)sink;
+	return all_match;
+}
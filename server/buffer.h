@@ -0,0 +1,42 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file buffer.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the packet codec benchmark
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __BUFFER_H__
+#define __BUFFER_H__
+
+#include "packetbuffer.h"
+
+#include <ostream>
+
+/**
+ * BufferWriter and BufferReader are in common/packetbuffer.h, shared with the client.
+ */
+class PacketCodec {
+public:
+	/**
+	 * encodes and decodes every message shape the server sends and receives, once with
+	 * BufferWriter/BufferReader and once the old way with a vector per number. the old way's
+	 * containers count their allocations, the codec never sees anything but the caller's buffer.
+	 *
+	 * \param os
+	 * \return false if a message does not round trip or the bounds checks overrun
+	 */
+	static bool benchmark(std::ostream& os);
+};
+
+#endif // __BUFFER_H__
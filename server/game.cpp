@@ -15,9 +15,14 @@ prior written consent of DigiPen Institute of Technology is prohibited.
 *******************************************************************/
 
 #include "game.h"
-#include <stdexcept>
+#include "reliable.h"
+#include "snapshot.h"
+#include "pipeline.h"
+#include "overlap.h"
+#include "buffer.h"
 #include <random>
 #include <fstream>
+#include <iomanip>
 
 #ifndef VERBOSE_LOGGING
 #define VERBOSE_LOGGING
@@ -28,243 +33,119 @@ Game& Game::getInstance() {
 	return game;
 }
 
-/**
- * locks Game::data variable for the whole function call.
- *
- */
-void Game::updateGame() {
-	// make a copy of Game data to avoid locking resource for too long
-	//Data data_copy;
-	//{
-	//	std::lock_guard<std::mutex> lock(data_mutex);
-	//	data_copy = data;
-	//}
-
-	std::chrono::duration<float> elapsed{};
-	auto start = std::chrono::high_resolution_clock::now();
-	auto last_asteroid_spawn_time = start;
-	auto prev_frame_time = start;
-
-	static bool prevGameRunning = gameRunning;
-	prevGameRunning = gameRunning;
-
-	while (gameRunning) {
-		const auto curr = std::chrono::high_resolution_clock::now();
-		const float dt = (float)(curr - prev_frame_time).count();
-
-		// sleep to not lock Game::data permanently
-		static constexpr int SLEEP_DURATION = 1000 / Server::TICK_RATE;
-		std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP_DURATION));
-		static std::vector<char> dbytes;
-
-		int num_spaceships{};
-		int num_dead_spaceships{};
-
-		// wont use a copy to avoid overwriting. 
-		// will have to run fn on a separate timed thread
+void Game::run() {
+	while (true) {
 		{
-			std::lock_guard<std::mutex> lock(data_mutex);
-
-			num_spaceships = (int)data.spaceships.size();
-			num_dead_spaceships = std::accumulate(
-				data.spaceships.begin(),
-				data.spaceships.end(),
-				0,
-				[](int n, const Spaceship& s) { return n + (s.lives_left ? 0 : 1); }
-			);
-
-			auto now = std::chrono::high_resolution_clock::now();
-			const float dt = std::chrono::duration_cast<std::chrono::duration<float>>(now - data.last_updated).count();
-
-			// update spaceships
-			for (Spaceship& s : data.spaceships) {
-				s.pos += s.vector * dt;
-
-				// Wrap spaceship positions 
-				if (s.pos.x < 0) {
-					s.pos.x = WINDOW_WIDTH;
-				}
-				else if (s.pos.x > WINDOW_WIDTH) {
-					s.pos.x = 0;
-				}
-
-				if (s.pos.y < 0) {
-					s.pos.y = WINDOW_HEIGHT;
-				}
-				else if (s.pos.y > WINDOW_HEIGHT) {
-					s.pos.y = 0;
-				}
-
-			}
-
-			// update bullets
-			for (auto it = data.bullets.begin(); it != data.bullets.end();) {
-				Bullet& b = *it;
-
-				// remove bullets out of screen
-				if (b.pos.x > WINDOW_WIDTH || b.pos.x < -WINDOW_WIDTH || b.pos.y > WINDOW_HEIGHT || b.pos.y < -WINDOW_HEIGHT) {
-					it = data.bullets.erase(it);
-					continue;
-				}
-
-				b.pos += b.vector * dt;
-				++it;
+			// sleep until a match starts, nothing to simulate in the lobby
+			std::unique_lock<std::mutex> lock(state_mutex);
+			state_cv.wait(lock, [this]() { return stopping || match_state == MatchState::RUNNING; });
+			if (stopping) {
+				return;
 			}
+		}
 
-			// update asteroids
-			for (Asteroid& a : data.asteroids) {
-				a.pos += a.vector * dt;
+		updateGame();
+	}
+}
 
-				// wrap asteroid positions
-				if (a.pos.x < -WINDOW_WIDTH) {
-					a.pos.x = WINDOW_WIDTH;
-				}
-				else if (a.pos.x > WINDOW_WIDTH) {
-					a.pos.x = -WINDOW_WIDTH;
-				}
+void Game::stop() {
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		stopping = true;
+	}
+	state_cv.notify_all();
+}
 
-				if (a.pos.y < -WINDOW_HEIGHT) {
-					a.pos.y = WINDOW_HEIGHT;
-				}
-				else if (a.pos.y > WINDOW_HEIGHT) {
-					a.pos.y = -WINDOW_HEIGHT;
-				}
-			}
+bool Game::transition(MatchState from, MatchState to) {
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		if (match_state != from) {
+			return false;
+		}
+		match_state = to;
+	}
+	state_cv.notify_all();
 
-			if ((int)data.asteroids.size() < MAX_ASTEROIDS && std::chrono::duration<float, std::milli>(curr - last_asteroid_spawn_time).count() > ASTEROID_SPAWN_INTERVAL_MS) {
 #ifdef VERBOSE_LOGGING
-				{
-					std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
-					std::cout << "Spawning new asteroid" << std::endl;
-				}
+	{
+		std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
+		std::cout << "Match " << matchStateName(from) << " -> " << matchStateName(to) << std::endl;
+	}
 #endif
+	return true;
+}
 
-				// spawn asteroid
-				last_asteroid_spawn_time = curr;
+const char* Game::matchStateName(MatchState state) {
+	switch (state) {
+	case MatchState::LOBBY: return "lobby";
+	case MatchState::STARTING: return "starting";
+	case MatchState::RUNNING: return "running";
+	case MatchState::ENDING: return "ending";
+	}
+	return "unknown";
+}
 
-				static auto randomFloat = [](float min, float max) {
-					static std::random_device rd;
-					static std::mt19937 rng;
-					std::uniform_real_distribution<float> dist(min, max);
-					return dist(rng);
-				};
+/**
+ * runs one fixed TICK_DT step per tick deadline that passed, then broadcasts one snapshot.
+ *
+ */
+void Game::updateGame() {
+	uint32_t seed;
+	{
+		std::lock_guard<std::mutex> lock(data_mutex);
+		seed = data.seed;
+	}
+	{
+		std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
+		std::cout << "match seed: " << seed << std::endl;
+	}
 
+	ticker.start();
 
-				Asteroid na{};
-				int edge = rand() % 4; // 0 = top, 1 = bottom, 2 = left, 3 = right
+	while (!stopping && matchState() == MatchState::RUNNING) {
+		// ticks that are due, more than 1 if the last tick overran
+		const int due = ticker.wait();
 
-				if (edge == 0) { // Top edge
-					na.pos = vec2(randomFloat(0, WINDOW_WIDTH), 0);
-					na.vector = vec2(randomFloat(-1.f, 1.f), randomFloat(0.5f, 1.f)); // Move downward
-				}
-				else if (edge == 1) { // Bottom edge
-					na.pos = vec2(randomFloat(0, WINDOW_WIDTH), WINDOW_HEIGHT);
-					na.vector = vec2(randomFloat(-1.f, 1.f), randomFloat(-1.f, -0.5f)); // Move upward
-				}
-				else if (edge == 2) { // Left edge
-					na.pos = vec2(0, randomFloat(0, WINDOW_HEIGHT));
-					na.vector = vec2(randomFloat(0.5f, 1.f), randomFloat(-1.f, 1.f)); // Move right
-				}
-				else { // Right edge
-					na.pos = vec2(WINDOW_WIDTH, randomFloat(0, WINDOW_HEIGHT));
-					na.vector = vec2(randomFloat(-1.f, -0.5f), randomFloat(-1.f, 1.f)); // Move left
-				}
+		int num_spaceships{};
+		int num_dead_spaceships{};
+		uint32_t tick{};
+		int dropped_ticks{};
 
-				na.vector *= ASTEROID_SPEED;
-				na.radius = (float)(rand() % (MAX_ASTEROID_RADIUS - MIN_ASTEROID_RADIUS) + MIN_ASTEROID_RADIUS);
+		// wont use a copy to avoid overwriting. 
+		// will have to run fn on a separate timed thread
+		{
+			std::lock_guard<std::mutex> lock(data_mutex);
 
-				data.asteroids.push_back(na);
+			const uint32_t tick_before = data.tick;
+			const int steps = std::min(due, MAX_CATCHUP_TICKS);
+			for (int i{}; i < steps; i++) {
+				step();
 			}
 
-			// check for collisions
-			for (auto a_it = data.asteroids.begin(); a_it != data.asteroids.end();) {
-				bool hasAsteroidCollided = false;
-
-				// Check collision with bullets
-				for (auto b_it = data.bullets.begin(); b_it != data.bullets.end();) {
-					if (!circleCollision({ b_it->pos, b_it->radius }, { a_it->pos, a_it->radius })) {
-						++b_it;
-						continue;
-					}
-
-					auto owner = std::find_if(data.spaceships.begin(), data.spaceships.end(),
-						[&b_it](const Spaceship& s) { return s.sid == b_it->sid; });
-
-					if (owner != data.spaceships.end()) {
-						owner->score += 1;
-					}
-
-					b_it = data.bullets.erase(b_it);
-					hasAsteroidCollided = true;
-					break;
-				}
-
-				if (hasAsteroidCollided) {
-					a_it = data.asteroids.erase(a_it); // Erase safely, and continue iteration
-					continue;
-				}
+			// stalled for longer than the catch up allows, drop the rest instead of spiralling
+			dropped_ticks = due - steps;
 
-				// Check collision with spaceships
-				for (auto s_it = data.spaceships.begin(); s_it != data.spaceships.end(); ++s_it) {
-					if (s_it->lives_left <= 0) continue;
-
-					if (!circleCollision({ s_it->pos, s_it->radius }, { a_it->pos, a_it->radius })) {
-						continue;
-					}
-
-#ifdef VERBOSE_LOGGING
-					{
-						std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
-						std::cout << "Spaceship " << s_it->sid << " lost 1 life" << std::endl;
-					}
-#endif
+			num_spaceships = (int)data.spaceships.size();
+			num_dead_spaceships = (int)std::count(data.spaceships.lives_left.begin(), data.spaceships.lives_left.end(), 0);
+			tick = data.tick;
 
-					data.killSpaceship(s_it);
-					hasAsteroidCollided = true;
-					break;
-				}
+			// scores and lives for readers outside the game thread
+			publish();
 
-				if (hasAsteroidCollided) {
-					a_it = data.asteroids.erase(a_it); // Erase safely
-				}
-				else {
-					++a_it;
-				}
+			// encoded and broadcast by the snapshot pipeline, outside the lock. once per SNAPSHOT_INTERVAL_TICKS,
+			// a catch up that crosses an interval still sends only the newest state
+			if (data.tick / SNAPSHOT_INTERVAL_TICKS != tick_before / SNAPSHOT_INTERVAL_TICKS) {
+				SnapshotPipeline::getInstance().publish(data);
 			}
-
-
-
-			// update last updated time
-			data.last_updated = std::chrono::high_resolution_clock::now();
-
-			// update sending buffer
-			dbytes = data.toBytes();
 		}
 
-		// data update is done, send to clients
-
-		// prepare payload
-		std::vector<char> sbuf;
-		sbuf.reserve(1 + dbytes.size()); // Avoids reallocations
-		sbuf.push_back(Server::ALL_ENTITIES);
-		sbuf.insert(sbuf.end(), dbytes.begin(), dbytes.end());
-
-#ifdef JS_DEBUG
-		std::vector<unsigned char> v(sbuf.begin(), sbuf.end());
-#endif
-
-
-		// broadcast data
-		Server::getInstance().broadcastData(sbuf);
-
-		// check elapsed time
-		elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (dropped_ticks > 0) {
+			std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
+			std::cout << "Game loop fell behind, dropped " << dropped_ticks << " tick(s)" << std::endl;
+		}
 
-		if (std::chrono::duration_cast<std::chrono::seconds>(elapsed).count() > GAME_DURATION_S) {
-			gameRunning = false;
-			{
-				std::lock_guard<std::mutex> lock(data_mutex);
-			}
+		if (tick >= GAME_DURATION_TICKS) {
+			transition(MatchState::RUNNING, MatchState::ENDING);
 			{
 				std::lock_guard<std::mutex> lock(Server::getInstance()._stdoutMutex);
 				std::cout << "Time is up, ending game.." << std::endl;
@@ -273,10 +154,7 @@ void Game::updateGame() {
 
 		// check if all spaceships are dead(out of lives)
 		if (num_dead_spaceships == num_spaceships) {
-			gameRunning = false;
-			{
-				std::lock_guard<std::mutex> lock(data_mutex);
-			}
+			transition(MatchState::RUNNING, MatchState::ENDING);
 			{
 				std::lock_guard<std::mutex> lock(Server::getInstance()._stdoutMutex);
 				std::cout << "All players are dead or disconnected, ending game.." << std::endl;
@@ -285,23 +163,28 @@ void Game::updateGame() {
 	}
 
 
-	if (prevGameRunning && !gameRunning) {
+	// inputs that came in during the last tick are not for the next match
+	Input stale;
+	while (inputs.pop(stale)) {}
+
+	// not ending if the server is shutting down
+	if (matchState() == MatchState::ENDING) {
 		std::cout << "Game ended sending " << std::endl;
 		// game ended, find winner sid
 		// !NOTE: draw conditions not handled
+		// final scores as of the last tick
+		const std::shared_ptr<const Published> final_state = published();
+
 		std::pair<int, int> winner_sid_score{ -1, -1 };
-		{
-			std::lock_guard<std::mutex> datalock(data_mutex);
-			for (const auto& s : data.spaceships) {
-				if (s.score > winner_sid_score.second) {
-					winner_sid_score = { s.sid, s.score };
-				}
+		for (const Published::Player& player : final_state->players) {
+			if (player.score > winner_sid_score.second) {
+				winner_sid_score = { player.sid, player.score };
 			}
+		}
 
-			// If no player has a positive score, assign a default winner
-			if (winner_sid_score.first == -1 && !data.spaceships.empty()) {
-				winner_sid_score.first = data.spaceships.front().sid;
-			}
+		// If no player has a positive score, assign a default winner
+		if (winner_sid_score.first == -1 && !final_state->players.empty()) {
+			winner_sid_score.first = final_state->players.front().sid;
 		}
 
 		// get all time highest scores from file
@@ -329,18 +212,8 @@ void Game::updateGame() {
 			for (auto it = highscores.begin(); it != highscores.end(); ++it) {
 				if (winner_sid_score.second > it->score) {
 					Highscore hs;
-					{
-						std::lock_guard<std::mutex> dlock(data_mutex);
-						auto dsit = std::find_if(data.spaceships.begin(), data.spaceships.end(), [&winner_sid_score](const Spaceship& s) {
-							return s.sid == winner_sid_score.first;
-							}
-						);
-						if (dsit == data.spaceships.end()) {
-							//std::cerr << "winner spaceship not found" << std::endl;
-						}
-						else {
-							hs.playername = dsit->name;
-						}
+					if (const Published::Player* winner = final_state->find(winner_sid_score.first)) {
+						hs.playername = winner->name;
 					}
 					hs.score = winner_sid_score.second;
 					hs.datestring = Server::getCurrentDateString();
@@ -355,18 +228,8 @@ void Game::updateGame() {
 
 			if (highscores.size() == 0) {
 				Highscore hs;
-				{
-					std::lock_guard<std::mutex> dlock(data_mutex);
-					auto dsit = std::find_if(data.spaceships.begin(), data.spaceships.end(), [&winner_sid_score](const Spaceship& s) {
-						return s.sid == winner_sid_score.first;
-						}
-					);
-					if (dsit == data.spaceships.end()) {
-						//std::cerr << "winner spaceship not found" << std::endl;
-					}
-					else {
-						hs.playername = dsit->name;
-					}
+				if (const Published::Player* winner = final_state->find(winner_sid_score.first)) {
+					hs.playername = winner->name;
 				}
 				hs.score = winner_sid_score.second;
 				hs.datestring = Server::getCurrentDateString();
@@ -374,97 +237,59 @@ void Game::updateGame() {
 			}
 		}
 
-		std::vector<char> ebuf;
-		ebuf.push_back(Server::END_GAME);			// cmd
-		ebuf.push_back(winner_sid_score.first);		// winner sid
-		ebuf.push_back(winner_sid_score.second);	// winner score
+		// kept by ReliableSender for retransmission, sized once
+		size_t size = 1 + sizeof(uint32_t) + 3;
+		for (const Highscore& hs : highscores) {
+			size += 2 + hs.playername.size();
+		}
+		std::vector<char> ebuf(size);
+		BufferWriter writer(ebuf.data(), ebuf.size());
+
+		writer.u8(Server::END_GAME);					// cmd
+		writer.u32(0);									// seq number, filled in by ReliableSender
+		writer.u8((uint8_t)winner_sid_score.first);		// winner sid
+		writer.u8((uint8_t)winner_sid_score.second);	// winner score
 
 		// populate highscores
-		ebuf.push_back((char)highscores.size());		// num highscores
+		writer.u8((uint8_t)highscores.size());			// num highscores
 
-		for (int i{}; i < (int)highscores.size(); i++) {
-			const Highscore& hs = highscores[i];
-			ebuf.push_back((char)hs.score);				// highscore
-			ebuf.push_back((char)hs.playername.size());	// playername length
-			ebuf.insert(ebuf.end(), hs.playername.begin(), hs.playername.end());	// playername
+		for (const Highscore& hs : highscores) {
+			writer.u8((uint8_t)hs.score);							// highscore
+			writer.u8((uint8_t)hs.playername.size());				// playername length
+			writer.bytes(hs.playername.data(), hs.playername.size());	// playername
 		}
 
 
-		auto reliable_bc = [this, ebuf]() {
-			std::chrono::duration<float> elapsed;
-			auto start_bc_time = std::chrono::high_resolution_clock::now();
-
-			while (true) {
-				int num_acked{};
-				{
-					std::lock_guard<std::mutex> aegclock(Server::getInstance().ack_end_game_clients_mutex);
-					num_acked = (int)Server::getInstance().ack_end_game_clients.size();
-				}
-
-				int expected_acks{};
-				{
-					std::lock_guard<std::mutex> datalock(data_mutex);
-					expected_acks = (int)data.spaceships.size();
-				}
+		std::vector<SESSION_ID> sids;
+		for (const Published::Player& player : final_state->players) {
+			sids.push_back(player.sid);
+		}
 
-				if (num_acked == expected_acks) {
-					std::lock_guard<std::mutex> stdoutLock(Server::getInstance()._stdoutMutex);
+		// broadcast through reliable udp communication, reset game data once every client acked or timed out
+		ReliableSender::getInstance().broadcast(std::move(ebuf), sids, [this](const std::vector<SESSION_ID>& unacked) {
+			{
+				std::lock_guard<std::mutex> stdoutLock(Server::getInstance()._stdoutMutex);
+				if (unacked.empty()) {
 					std::cout << "All clients ACKed END_GAME command" << std::endl;
-					{
-						std::lock_guard<std::mutex> aegclock(Server::getInstance().ack_end_game_clients_mutex);
-						Server::getInstance().ack_end_game_clients.clear();
-					}
-					break;
 				}
-
-				Server::getInstance().broadcastData(ebuf);
-
-				std::this_thread::sleep_for(std::chrono::milliseconds(Server::TIMEOUT_MS));
-
-				elapsed = std::chrono::high_resolution_clock::now() - start_bc_time;
-				if (elapsed.count() >= Server::DISCONNECTION_TIMEOUT_DURATION_MS / 1000.f) {
-					// disconnect clients that did not ack
-					{
-						std::lock_guard<std::mutex> stdoutLock(Server::getInstance()._stdoutMutex);
-						std::cout << num_acked << "/" << expected_acks << " ACKed END_GAME command. Disconnecting timed out clients." << std::endl;
-					}
-
-					std::unordered_set<SESSION_ID> acked;
-					{
-						std::lock_guard<std::mutex> aegclock(Server::getInstance().ack_end_game_clients_mutex);
-						acked = Server::getInstance().ack_end_game_clients;
-					}
-
-					{
-						std::lock_guard<std::mutex> datalock2(data_mutex);
-						for (auto it = data.spaceships.begin(); it != data.spaceships.end();) {
-							if (acked.find(it->sid) != acked.end()) {
-								++it;
-								continue;
-							}
-
-							// spaceship(client) did not ack, remove
-							it = data.spaceships.erase(it);
-						}
-					}
-
-					{
-						std::lock_guard<std::mutex> aegclock(Server::getInstance().ack_end_game_clients_mutex);
-						Server::getInstance().ack_end_game_clients.clear();
-					}
+				else {
+					std::cout << unacked.size() << " client(s) did not ACK END_GAME command. Disconnecting timed out clients." << std::endl;
 				}
 			}
 
-			{
-				std::lock_guard<std::mutex> lock(data_mutex);
-				data.reset();
+			std::lock_guard<std::mutex> lock(data_mutex);
+
+			// spaceship(client) did not ack, remove
+			for (SESSION_ID sid : unacked) {
+				data.removeSpaceship(sid);
 			}
-		};
-		//std::thread rbc(reliable_bc);
-		{
-			std::lock_guard<std::mutex> tplock(Server::threadpool_mutex);
-			Server::threadpool.push_back(std::async(std::launch::async, reliable_bc));
-		}
+
+			data.reset();
+			publish();
+
+			// new players can join and start the next match
+			transition(MatchState::ENDING, MatchState::LOBBY);
+		});
 
 		// update highscore file
 		{
@@ -482,97 +307,564 @@ void Game::updateGame() {
 					<< hs.datestring << "\n";
 			}
 		}
+	}
+}
+
+
+void Game::step() {
+	// spaceships are only added or removed under data_mutex, the slots hold for the whole tick
+	spaceship_slot.fill(-1);
+	for (size_t i{}; i < data.spaceships.size(); i++) {
+		spaceship_slot[data.spaceships.sid[i] & 0xff] = (int)i;
+	}
+
+	applyInputs();
+
+	moveEntities(data, TICK_DT);
+
+	if ((int)data.asteroids.size() < MAX_ASTEROIDS && data.tick - data.last_asteroid_spawn_tick > ASTEROID_SPAWN_INTERVAL_TICKS) {
+#ifdef VERBOSE_LOGGING
+		{
+			std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
+			std::cout << "Spawning new asteroid" << std::endl;
+		}
+#endif
+
+		// spawn asteroid
+		data.last_asteroid_spawn_tick = data.tick;
+
+		auto randomFloat = [this](float min, float max) {
+			std::uniform_real_distribution<float> dist(min, max);
+			return dist(data.rng);
+		};
+
+		vec2 pos, vector;
+		const int edge = std::uniform_int_distribution<int>(0, 3)(data.rng); // 0 = top, 1 = bottom, 2 = left, 3 = right
+
+		if (edge == 0) { // Top edge
+			pos = vec2(randomFloat(0, WINDOW_WIDTH), 0);
+			vector = vec2(randomFloat(-1.f, 1.f), randomFloat(0.5f, 1.f)); // Move downward
+		}
+		else if (edge == 1) { // Bottom edge
+			pos = vec2(randomFloat(0, WINDOW_WIDTH), WINDOW_HEIGHT);
+			vector = vec2(randomFloat(-1.f, 1.f), randomFloat(-1.f, -0.5f)); // Move upward
+		}
+		else if (edge == 2) { // Left edge
+			pos = vec2(0, randomFloat(0, WINDOW_HEIGHT));
+			vector = vec2(randomFloat(0.5f, 1.f), randomFloat(-1.f, 1.f)); // Move right
+		}
+		else { // Right edge
+			pos = vec2(WINDOW_WIDTH, randomFloat(0, WINDOW_HEIGHT));
+			vector = vec2(randomFloat(-1.f, -0.5f), randomFloat(-1.f, 1.f)); // Move left
+		}
+
+		vector *= ASTEROID_SPEED;
+		const float radius = (float)std::uniform_int_distribution<int>(MIN_ASTEROID_RADIUS, MAX_ASTEROID_RADIUS - 1)(data.rng);
 
-		prevGameRunning = gameRunning;
+		const uint32_t id = data.ids.allocate();
+		if (id != EntityIds::INVALID) {
+			data.asteroids.add(id, pos, vector, radius);
+		}
 	}
+
+	checkCollisions();
+
+	data.tick++;
 }
 
+void Game::applyInputs() {
+	Input input;
+	while (inputs.pop(input)) {
+		const int spaceship = spaceship_slot[input.sid & 0xff];
 
-std::vector<char> Game::Data::toBytes() {
-	std::vector<char> buf;
+		if (input.type == Input::Type::SPACESHIP) {
+			// reordered or duplicated on the way, a newer input already set the velocity
+			if (spaceship < 0 || (int32_t)(input.seq - data.spaceships.input_seq[spaceship]) <= 0) {
+				continue;
+			}
+			data.spaceships.input_seq[spaceship] = input.seq;
+			data.spaceships.vx[spaceship] = input.vector.x;
+			data.spaceships.vy[spaceship] = input.vector.y;
+			data.spaceships.rotation[spaceship] = input.rotation;
+			continue;
+		}
 
-	// num spaceships
-	buf.push_back((char)spaceships.size());
-	std::vector<char> bytes;
+		// bullet ids are chosen by each client, only unique within a session
+		bool registered = false;
+		for (size_t i{}; i < data.bullets.size() && !registered; i++) {
+			registered = data.bullets.bullet_id[i] == input.bullet_id && data.bullets.sid[i] == input.sid;
+		}
+		if (registered) {
+			// bullet has already been registered, ignore.
+			continue;
+		}
 
-	for (const Spaceship& s : spaceships) {
-		// only stuff integral to rendering/interaction is sent
-		// vector is not sent
+		const uint32_t id = data.ids.allocate();
+		if (id == EntityIds::INVALID) {
+			// out of ids, dropped like an input that did not fit the queue
+			continue;
+		}
+		data.bullets.add(id, input.sid, input.bullet_id, input.pos, input.vector);
 
-		buf.push_back(s.sid & 0xff);		// spaceship sid
+#ifdef VERBOSE_LOGGING
+		{
+			std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
+			std::cout << "Registering new bullet " << input.sid << ":" << input.bullet_id << std::endl;
+		}
+#endif
+	}
+}
+
+void Game::publish() {
+	auto next = std::make_shared<Published>();
+	next->tick = data.tick;
+	next->players.reserve(data.spaceships.size());
+	for (size_t i{}; i < data.spaceships.size(); i++) {
+		next->players.push_back({ data.spaceships.sid[i], data.spaceships.name[i], data.spaceships.lives_left[i], data.spaceships.score[i] });
+	}
+
+	std::atomic_store(&published_state, std::shared_ptr<const Published>(std::move(next)));
+}
+
+void Game::printStats(std::ostream& os) const {
+	os << "inputs dropped (queue full): " << droppedInputs() << std::endl;
+	ticker.printStats(os);
+}
+
+bool Game::circleCollision(Circle c1, Circle c2) {
+	const float r = c1.radius + c2.radius;
+
+	// shortest distance across the wrap
+	vec2 d = c2.pos - c1.pos;
+	if (d.x > WINDOW_WIDTH) d.x -= 2.f * WINDOW_WIDTH;
+	else if (d.x < -WINDOW_WIDTH) d.x += 2.f * WINDOW_WIDTH;
+	if (d.y > WINDOW_HEIGHT) d.y -= 2.f * WINDOW_HEIGHT;
+	else if (d.y < -WINDOW_HEIGHT) d.y += 2.f * WINDOW_HEIGHT;
+
+	return d.lengthSq() <= r * r;
+}
+
+namespace {
+	// removes flagged entities by swapping in the last one and releases their ids
+	template <typename Store>
+	void eraseFlagged(Store& entities, std::vector<char>& flagged, Game::EntityIds& ids) {
+		for (size_t i{}; i < entities.size();) {
+			if (!flagged[i]) {
+				i++;
+				continue;
+			}
+			ids.release(entities.id[i]);
+			flagged[i] = flagged.back();
+			flagged.pop_back();
+			entities.swapRemove(i);
+		}
+	}
+}
+
+void Game::moveEntities(Data& d, float dt) {
+	static constexpr Motion::Bounds window{ 0, (float)WINDOW_WIDTH, 0, (float)WINDOW_HEIGHT };
+	static constexpr Motion::Bounds world{ -(float)WINDOW_WIDTH, (float)WINDOW_WIDTH, -(float)WINDOW_HEIGHT, (float)WINDOW_HEIGHT };
+
+	// update spaceships, wrap inside the window
+	d.spaceships.integrateWrapped(dt, window);
+
+	// update bullets, remove bullets out of the world
+	thread_local std::vector<char> outside;
+	if (d.bullets.integrateCulled(dt, world, outside)) {
+		eraseFlagged(d.bullets, outside, d.ids);
+	}
+
+	// update asteroids, wrap inside the world
+	d.asteroids.integrateWrapped(dt, world);
+}
+
+namespace {
+	// the array of structs layout Game::Data used before Bodies, only kept as the baseline of Game::benchmark
+	struct LegacyAsteroid {
+		Game::vec2 pos{};
+		Game::vec2 vector{};
+		float radius{};
+		uint32_t id{};
+	};
+
+	struct LegacyBullet : public LegacyAsteroid {
+		int bullet_id{};
+		SESSION_ID sid{};
+		float radius{ Game::BULLET_RADIUS };
+	};
+
+	struct LegacySpaceship : public LegacyBullet {
+		float rotation{};
+		int lives_left{};
+		int score{};
+		std::string name{};
+	};
+}
+
+void Game::benchmark(std::ostream& os) {
+	static constexpr float dt = TICK_DT;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> pos_x(-(float)WINDOW_WIDTH, (float)WINDOW_WIDTH);
+	std::uniform_real_distribution<float> pos_y(-(float)WINDOW_HEIGHT, (float)WINDOW_HEIGHT);
+	std::uniform_real_distribution<float> speed(-ASTEROID_SPEED, ASTEROID_SPEED);
+
+	os << "entity layout benchmark, move and wrap half asteroids and half spaceships, time per tick" << std::endl;
+
+	for (int n : { 10, 100, 1000, 10000 }) {
+		std::vector<LegacyAsteroid> legacy_asteroids;
+		std::vector<LegacySpaceship> legacy_spaceships;
+		Data d;
+		for (int i{}; i < n / 2; i++) {
+			const vec2 pos{ pos_x(rng), pos_y(rng) };
+			const vec2 vector{ speed(rng), speed(rng) };
+
+			LegacyAsteroid la{};
+			la.pos = pos;
+			la.vector = vector;
+			legacy_asteroids.push_back(la);
+			d.asteroids.add(d.ids.allocate(), pos, vector, (float)MIN_ASTEROID_RADIUS);
+
+			LegacySpaceship ls{};
+			ls.pos = { pos.x + WINDOW_WIDTH / 2.f, pos.y + WINDOW_HEIGHT / 2.f };
+			ls.vector = vector;
+			legacy_spaceships.push_back(ls);
+			const size_t s = d.spaceships.add(d.ids.allocate(), i, "player");
+			d.spaceships.x[s] = ls.pos.x;
+			d.spaceships.y[s] = ls.pos.y;
+			d.spaceships.vx[s] = vector.x;
+			d.spaceships.vy[s] = vector.y;
+		}
+
+		// one batch is ~2M entity updates
+		const int reps = std::max(1, 2000000 / n);
+
+		const double aos_us = bestOf(reps, [&]() {
+			// the old updateGame loops
+			for (LegacySpaceship& s : legacy_spaceships) {
+				s.pos += s.vector * dt;
+				if (s.pos.x < 0) s.pos.x = WINDOW_WIDTH;
+				else if (s.pos.x > WINDOW_WIDTH) s.pos.x = 0;
+				if (s.pos.y < 0) s.pos.y = WINDOW_HEIGHT;
+				else if (s.pos.y > WINDOW_HEIGHT) s.pos.y = 0;
+			}
+			for (LegacyAsteroid& a : legacy_asteroids) {
+				a.pos += a.vector * dt;
+				if (a.pos.x < -WINDOW_WIDTH) a.pos.x = WINDOW_WIDTH;
+				else if (a.pos.x > WINDOW_WIDTH) a.pos.x = -WINDOW_WIDTH;
+				if (a.pos.y < -WINDOW_HEIGHT) a.pos.y = WINDOW_HEIGHT;
+				else if (a.pos.y > WINDOW_HEIGHT) a.pos.y = -WINDOW_HEIGHT;
+			}
+		});
 
-		bytes = Server::t_to_bytes(s.pos.x);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// pos x (4 bytes)
+		const double soa_us = bestOf(reps, [&]() {
+			moveEntities(d, dt);
+		});
 
-		bytes = Server::t_to_bytes(s.pos.y);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// pos y (4 bytes)
+		// both layouts ran the same number of ticks and must have ended up in the same place
+		bool same = true;
+		for (size_t i{}; i < legacy_asteroids.size(); i++) {
+			same = same && legacy_asteroids[i].pos.x == d.asteroids.x[i] && legacy_spaceships[i].pos.y == d.spaceships.y[i];
+		}
 
-		bytes = Server::t_to_bytes(s.rotation);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// rotation in degrees (4 bytes)
+		os << "n=" << std::setw(5) << n
+			<< std::fixed << std::setprecision(2)
+			<< " aos=" << std::setw(8) << aos_us << "us"
+			<< " soa=" << std::setw(8) << soa_us << "us"
+			<< " (" << aos_us / soa_us << "x)"
+			<< std::defaultfloat
+			<< (same ? "" : " MISMATCH between layouts") << std::endl;
+	}
+}
 
-		buf.push_back(s.lives_left);						// lives left (1 byte)
+void Game::checkCollisions() {
+	const Bullets& bullets = data.bullets;
+	Spaceships& spaceships = data.spaceships;
+	const Asteroids& asteroids = data.asteroids;
 
-		buf.push_back(s.score);								// score (1 byte)
+	// bullets and spaceships go into the grid, each asteroid only tests the ones around it
+	const uint32_t num_bullets = (uint32_t)bullets.size();
+	broadphase.clear();
+	for (uint32_t i{}; i < num_bullets; i++) {
+		broadphase.insert(i, bullets.x[i], bullets.y[i], bullets.radius[i]);
+	}
+	for (uint32_t i{}; i < (uint32_t)spaceships.size(); i++) {
+		broadphase.insert(num_bullets + i, spaceships.x[i], spaceships.y[i], spaceships.radius[i]);
 	}
+	broadphase.build();
+
+	bullet_hit.assign(num_bullets, false);
+	asteroid_hit.assign(asteroids.size(), false);
+
+	for (size_t a{}; a < asteroids.size(); a++) {
+		const Circle ac{ { asteroids.x[a], asteroids.y[a] }, asteroids.radius[a] };
+
+		// only bullets not hit yet and living spaceships can collide, gather them for one batched test
+		candidates.clear();
+		candidate_x.clear();
+		candidate_y.clear();
+		candidate_r.clear();
+		broadphase.query(ac.pos.x, ac.pos.y, ac.radius, [&](uint32_t i) {
+			if (i < num_bullets) {
+				if (bullet_hit[i]) {
+					return;
+				}
+				candidate_x.push_back(bullets.x[i]);
+				candidate_y.push_back(bullets.y[i]);
+				candidate_r.push_back(bullets.radius[i]);
+			}
+			else {
+				const uint32_t si = i - num_bullets;
+				if (spaceships.lives_left[si] <= 0) {
+					return;
+				}
+				candidate_x.push_back(spaceships.x[si]);
+				candidate_y.push_back(spaceships.y[si]);
+				candidate_r.push_back(spaceships.radius[si]);
+			}
+			candidates.push_back(i);
+		});
 
-	// num bullets
-	buf.push_back((char)bullets.size());
+		candidate_hits.resize(Overlap::words(candidates.size()));
+		if (Overlap::oneToMany(ac.pos.x, ac.pos.y, ac.radius, candidate_x.data(), candidate_y.data(), candidate_r.data(), candidates.size(),
+			(float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, candidate_hits.data()) == 0) {
+			continue;
+		}
 
-	for (const Bullet& b : bullets) {
-		// vector is not sent, not integral to rendering
+		// like the old nested loops, the first bullet in container order wins, then the first spaceship.
+		// spaceships are tested at their current position, a spaceship killed earlier this tick
+		// has already moved back to the center
+		uint32_t bullet = UINT32_MAX;
+		uint32_t spaceship = UINT32_MAX;
+		for (size_t c{}; c < candidates.size(); c++) {
+			if (!(candidate_hits[c / 64] >> (c % 64) & 1)) {
+				continue;
+			}
+			const uint32_t i = candidates[c];
+			if (i < num_bullets) {
+				bullet = std::min(bullet, i);
+			}
+			else {
+				spaceship = std::min(spaceship, i - num_bullets);
+			}
+		}
 
-		buf.push_back(b.sid & 0xff);		// bullet sid
+		if (bullet != UINT32_MAX) {
+			const int owner = spaceship_slot[bullets.sid[bullet] & 0xff];
+			if (owner >= 0) {
+				spaceships.score[owner] += 1;
+			}
 
-		bytes = Server::t_to_bytes(b.pos.x);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// pos x (4 bytes)
+			bullet_hit[bullet] = true;
+			asteroid_hit[a] = true;
+		}
+		else if (spaceship != UINT32_MAX) {
+#ifdef VERBOSE_LOGGING
+			{
+				std::lock_guard<std::mutex> coutlock(Server::getInstance()._stdoutMutex);
+				std::cout << "Spaceship " << spaceships.sid[spaceship] << " lost 1 life" << std::endl;
+			}
+#endif
 
-		bytes = Server::t_to_bytes(b.pos.y);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// pos y (4 bytes)
+			data.killSpaceship(spaceship);
+			asteroid_hit[a] = true;
+		}
 	}
 
-	// num asteroids
-	buf.push_back((char)asteroids.size());
+	eraseFlagged(data.bullets, bullet_hit, data.ids);
+	eraseFlagged(data.asteroids, asteroid_hit, data.ids);
+}
 
-	for (const Asteroid& a : asteroids) {
-		// vector not sent, not needed for rendering
+void Game::Bodies::integrateWrapped(float dt, const Motion::Bounds& wrap) {
+	Motion::integrateWrapped(x.data(), y.data(), vx.data(), vy.data(), size(), dt, wrap);
+}
 
-		bytes = Server::t_to_bytes(a.pos.x);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// pos x (4 bytes)
+size_t Game::Bodies::integrateCulled(float dt, const Motion::Bounds& bounds, std::vector<char>& outside) {
+	outside.resize(size());
+	return Motion::integrateCulled(x.data(), y.data(), vx.data(), vy.data(), size(), dt, bounds, outside.data());
+}
 
-		bytes = Server::t_to_bytes(a.pos.y);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// pos y (4 bytes)
+size_t Game::Bodies::addBody(uint32_t new_id, vec2 pos, vec2 vector, float r) {
+	id.push_back(new_id);
+	x.push_back(pos.x);
+	y.push_back(pos.y);
+	vx.push_back(vector.x);
+	vy.push_back(vector.y);
+	radius.push_back(r);
+	return id.size() - 1;
+}
 
-		bytes = Server::t_to_bytes(a.radius);
-		buf.insert(buf.end(), bytes.begin(), bytes.end());	// asteroid radius (4 bytes)
+namespace {
+	template <typename T>
+	void swapPop(std::vector<T>& v, size_t i) {
+		if (i + 1 != v.size()) {
+			v[i] = std::move(v.back());
+		}
+		v.pop_back();
 	}
+}
 
-	return buf;
+void Game::Bodies::swapRemoveBody(size_t i) {
+	swapPop(id, i);
+	swapPop(x, i);
+	swapPop(y, i);
+	swapPop(vx, i);
+	swapPop(vy, i);
+	swapPop(radius, i);
 }
 
-bool Game::circleCollision(Circle c1, Circle c2) {
-	const float rsq = powf(c1.radius + c2.radius, 2.f);
-	const float dsq = (c2.pos - c1.pos).lengthSq();
+void Game::Bodies::clearBodies() {
+	id.clear();
+	x.clear();
+	y.clear();
+	vx.clear();
+	vy.clear();
+	radius.clear();
+}
+
+size_t Game::Asteroids::add(uint32_t new_id, vec2 pos, vec2 vector, float r) {
+	return addBody(new_id, pos, vector, r);
+}
+
+void Game::Asteroids::swapRemove(size_t i) {
+	swapRemoveBody(i);
+}
 
-	return dsq <= rsq;
+void Game::Asteroids::clear() {
+	clearBodies();
+}
+
+size_t Game::Bullets::add(uint32_t new_id, SESSION_ID new_sid, int new_bullet_id, vec2 pos, vec2 vector) {
+	sid.push_back(new_sid);
+	bullet_id.push_back(new_bullet_id);
+	return addBody(new_id, pos, vector, BULLET_RADIUS);
+}
+
+void Game::Bullets::swapRemove(size_t i) {
+	swapRemoveBody(i);
+	swapPop(sid, i);
+	swapPop(bullet_id, i);
+}
+
+void Game::Bullets::clear() {
+	clearBodies();
+	sid.clear();
+	bullet_id.clear();
+}
+
+size_t Game::Spaceships::add(uint32_t new_id, SESSION_ID new_sid, std::string new_name) {
+	sid.push_back(new_sid);
+	rotation.push_back(0.f);
+	lives_left.push_back(NUM_START_LIVES);
+	score.push_back(0);
+	input_seq.push_back(0);
+	name.push_back(std::move(new_name));
+	return addBody(new_id, { 0, 0 }, { 0, 0 }, SPACESHIP_RADIUS);
+}
+
+void Game::Spaceships::swapRemove(size_t i) {
+	swapRemoveBody(i);
+	swapPop(sid, i);
+	swapPop(rotation, i);
+	swapPop(lives_left, i);
+	swapPop(score, i);
+	swapPop(input_seq, i);
+	swapPop(name, i);
+}
+
+void Game::Spaceships::clear() {
+	clearBodies();
+	sid.clear();
+	rotation.clear();
+	lives_left.clear();
+	score.clear();
+	input_seq.clear();
+	name.clear();
+}
+
+int Game::Spaceships::find(SESSION_ID s) const {
+	auto it = std::find(sid.begin(), sid.end(), s);
+	return it == sid.end() ? -1 : (int)(it - sid.begin());
+}
+
+uint32_t Game::Data::newSeed() {
+	return std::random_device{}();
 }
 
 void Game::Data::reset() {
+	reset(newSeed());
+}
+
+void Game::Data::reset(uint32_t new_seed) {
+	for (uint32_t id : bullets.id) ids.release(id);
+	for (uint32_t id : asteroids.id) ids.release(id);
 	bullets.clear();
 	asteroids.clear();
-	last_updated = std::chrono::high_resolution_clock::now();
-
-	for (Spaceship& s : spaceships) {
-		s.pos = { WINDOW_WIDTH / 2.f, WINDOW_HEIGHT / 2.f };
-		s.vector = { 0,0 };
-		s.rotation = 3.3f;
-		s.lives_left = Game::NUM_START_LIVES;
-		s.score = 0;
+	tick = 0;
+	last_asteroid_spawn_tick = 0;
+	seed = new_seed;
+	rng.seed(seed);
+
+	for (size_t i{}; i < spaceships.size(); i++) {
+		spaceships.x[i] = WINDOW_WIDTH / 2.f;
+		spaceships.y[i] = WINDOW_HEIGHT / 2.f;
+		spaceships.vx[i] = 0;
+		spaceships.vy[i] = 0;
+		spaceships.rotation[i] = 3.3f;
+		spaceships.lives_left[i] = Game::NUM_START_LIVES;
+		spaceships.score[i] = 0;
+	}
+}
+
+void Game::Data::removeSpaceship(SESSION_ID sid) {
+	const int i = spaceships.find(sid);
+	if (i < 0) {
+		return;
+	}
+	ids.release(spaceships.id[i]);
+	spaceships.swapRemove(i);
+}
+
+void Game::Data::killSpaceship(size_t i) {
+	spaceships.x[i] = WINDOW_WIDTH / 2.f;
+	spaceships.y[i] = WINDOW_HEIGHT / 2.f;
+	spaceships.vx[i] = 0;
+	spaceships.vy[i] = 0;
+	spaceships.rotation[i] = 0.f;
+	spaceships.lives_left[i]--;
+}
+
+uint32_t Game::EntityIds::allocate() {
+	uint16_t s;
+	if (!free_slots.empty()) {
+		s = free_slots.back();
+		free_slots.pop_back();
+	}
+	else {
+		if (generations.size() > UINT16_MAX) {
+			return INVALID;
+		}
+		s = (uint16_t)generations.size();
+		generations.push_back(1);
+	}
+	return (uint32_t)generations[s] << 16 | s;
+}
+
+bool Game::EntityIds::release(uint32_t id) {
+	if (!alive(id)) {
+		return false;
+	}
+
+	const uint16_t s = slot(id);
+	if (++generations[s] != 0) {
+		free_slots.push_back(s);
 	}
+	// else the generation wrapped, retire the slot so old ids stay unique
+	return true;
 }
 
-void Game::Data::killSpaceship(std::vector<Spaceship>::iterator& it) {
-	it->pos = { WINDOW_WIDTH / 2.f, WINDOW_HEIGHT / 2.f };
-	it->vector = { 0,0 };
-	it->rotation = 0.f;
-	it->lives_left--;
+bool Game::EntityIds::alive(uint32_t id) const {
+	const uint16_t s = slot(id);
+	// generation 0 is never handed out, that also covers INVALID and retired slots
+	return generation(id) != 0 && s < generations.size() && generations[s] == generation(id);
 }
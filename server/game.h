@@ -20,6 +20,12 @@ prior written consent of DigiPen Institute of Technology is prohibited.
 #define __GAME_H__
 
 #include "server.h"
+#include "broadphase.h"
+#include "motion.h"
+#include "ticker.h"
+#include "mpscqueue.h"
+#include <memory>
+#include <random>
 
 
 class Game {
@@ -42,10 +48,55 @@ public:
 	static constexpr float ASTEROID_SPEED = 80.f;
 	static constexpr int MAX_ASTEROIDS = 20;
 
+	// the simulation always steps by TICK_DT, independent of how late the game thread wakes up
+	static constexpr auto TICK_DURATION = std::chrono::nanoseconds(1000000000 / Server::TICK_RATE);
+	static constexpr float TICK_DT = 1.f / Server::TICK_RATE;
+	static constexpr uint32_t GAME_DURATION_TICKS = GAME_DURATION_S * Server::TICK_RATE;
+	static constexpr uint32_t ASTEROID_SPAWN_INTERVAL_TICKS = ASTEROID_SPAWN_INTERVAL_MS * Server::TICK_RATE / 1000;
+
+	// ticks run back to back after a stall, ticks beyond that are dropped instead of caught up
+	static constexpr int MAX_CATCHUP_TICKS = 5;
+
+	// ALL_ENTITIES is broadcast every few ticks instead of every tick
+	static constexpr uint32_t SNAPSHOT_INTERVAL_TICKS = Server::TICK_RATE / Server::SNAPSHOT_RATE;
+	static_assert(Server::TICK_RATE % Server::SNAPSHOT_RATE == 0, "snapshots must land on ticks");
+
 	static Game& getInstance();
 
-	bool gameRunning = false;		// for updateGame loop
-	bool gameThreadRunning = true;	// for updateGame loop thread
+	/**
+	 * lobby: players join, a start request moves to starting.
+	 * starting: START_GAME is being acked, then running, or back to lobby if a client did not ack.
+	 * running: updateGame ticks until time is up or every player is dead.
+	 * ending: END_GAME is being acked, then back to lobby.
+	 */
+	enum class MatchState {
+		LOBBY,
+		STARTING,
+		RUNNING,
+		ENDING,
+	};
+
+	MatchState matchState() const { return match_state; }
+
+	/**
+	 * moves the match to another state and wakes up the threads waiting on it.
+	 *
+	 * \param from
+	 * \param to
+	 * \return false if the match was not in from, nothing changes then
+	 */
+	bool transition(MatchState from, MatchState to);
+
+	static const char* matchStateName(MatchState state);
+
+	/**
+	 * body of the game thread, blocks until a match is running, runs it, and repeats until stop.
+	 *
+	 */
+	void run();
+
+	// makes run return, a running match is abandoned without END_GAME
+	void stop();
 
 	// game stuff
 	static constexpr int MAX_PLAYERS = 4;
@@ -100,40 +151,203 @@ public:
 	};
 
 
-	struct Asteroid {
-		vec2 pos{};
-		vec2 vector{};
-		float radius{};
+	/**
+	 * allocates the ids of spaceships, bullets and asteroids.
+	 *
+	 * an id is the slot index in the low 16 bits and the slot generation in the high 16 bits.
+	 * releasing an id bumps the generation of its slot, so a stale id held by a snapshot or
+	 * client never matches the entity that reuses the slot. a slot whose generation would
+	 * wrap is retired instead of reused.
+	 */
+	class EntityIds {
+	public:
+		static constexpr uint32_t INVALID = 0;		// generations start at 1
+
+		/**
+		 * \return INVALID when every slot is live or retired, the caller skips the spawn
+		 */
+		uint32_t allocate();
+
+		/**
+		 * \param id
+		 * \return false if id is stale or was never allocated
+		 */
+		bool release(uint32_t id);
+
+		bool alive(uint32_t id) const;
+
+		static uint16_t slot(uint32_t id) { return id & 0xffff; }
+		static uint16_t generation(uint32_t id) { return id >> 16; }
+
+	private:
+		std::vector<uint16_t> generations;	// current generation of each slot
+		std::vector<uint16_t> free_slots;
+	};
+
+	/**
+	 * hot data shared by every entity kind, one array per field. index i of every array is
+	 * the same entity. removal moves the last entity into the hole, so indices only hold
+	 * until the next removal, use ids to refer to entities across ticks.
+	 */
+	struct Bodies {
+		std::vector<uint32_t> id;		// from Data::ids, matches entities across snapshots
+		std::vector<float> x, y;		// position
+		std::vector<float> vx, vy;		// velocity per second
+		std::vector<float> radius;
+
+		size_t size() const { return id.size(); }
+		bool empty() const { return id.empty(); }
+
+		/**
+		 * moves every body by its velocity and wraps it to the other side when it leaves
+		 * min..max (Motion::integrateWrapped).
+		 *
+		 * \param dt seconds
+		 * \param wrap
+		 */
+		void integrateWrapped(float dt, const Motion::Bounds& wrap);
+
+		/**
+		 * moves every body by its velocity and flags the ones outside bounds (Motion::integrateCulled).
+		 *
+		 * \param dt seconds
+		 * \param bounds
+		 * \param outside resized to size(), 1 if outside
+		 * \return number of bodies outside
+		 */
+		size_t integrateCulled(float dt, const Motion::Bounds& bounds, std::vector<char>& outside);
+
+	protected:
+		size_t addBody(uint32_t id, vec2 pos, vec2 vector, float radius);
+		void swapRemoveBody(size_t i);
+		void clearBodies();
+	};
+
+	struct Asteroids : Bodies {
+		size_t add(uint32_t id, vec2 pos, vec2 vector, float radius);
+		void swapRemove(size_t i);
+		void clear();
+	};
+
+	struct Bullets : Bodies {
+		std::vector<SESSION_ID> sid;
+		std::vector<int> bullet_id;		// chosen by the client, only unique per session
+
+		size_t add(uint32_t id, SESSION_ID sid, int bullet_id, vec2 pos, vec2 vector);
+		void swapRemove(size_t i);
+		void clear();
 	};
 
-	struct Bullet : public Asteroid {
-		int bullet_id{};
+	struct Spaceships : Bodies {
+		std::vector<SESSION_ID> sid;
+		std::vector<float> rotation;
+		std::vector<int> lives_left;
+		std::vector<int> score;
+		std::vector<uint32_t> input_seq;	// newest SELF_SPACESHIP applied, clients reconcile their prediction against it
+		std::vector<std::string> name;	// cold, only read on game start and end
+
+		size_t add(uint32_t id, SESSION_ID sid, std::string name);
+		void swapRemove(size_t i);
+		void clear();
+
+		/**
+		 * \param sid
+		 * \return index of the spaceship of sid, -1 if there is none
+		 */
+		int find(SESSION_ID sid) const;
+	};
+
+	// a decoded SELF_SPACESHIP or NEW_BULLET, applied by the game thread at the start of the next tick
+	struct Input {
+		enum class Type : uint8_t {
+			SPACESHIP,
+			BULLET,
+		};
+
+		Type type{};
 		SESSION_ID sid{};
-		float radius{ BULLET_RADIUS };
+		int bullet_id{};	// bullet only
+		uint32_t seq{};		// spaceship only, increases with every SELF_SPACESHIP of a session
+		vec2 pos;			// bullet only
+		vec2 vector;
+		float rotation{};	// spaceship only
 	};
 
-	struct Spaceship : public Bullet {
-		float rotation{};
-		int lives_left{};
-		int score{};
-		std::string name{};
+	static constexpr int INPUT_QUEUE_SIZE = 1024;
+
+	/**
+	 * queues an input for the next tick. any thread, takes no lock.
+	 *
+	 * \param input
+	 * \return false if the queue is full and the input was dropped
+	 */
+	bool pushInput(const Input& input) { return inputs.push(input); }
+
+	uint64_t droppedInputs() const { return inputs.dropped(); }
+
+	/**
+	 * immutable copy of what threads other than the game thread read from data.
+	 * republished after every tick and every join or leave, readers never take data_mutex.
+	 */
+	struct Published {
+		struct Player {
+			SESSION_ID sid;
+			std::string name;
+			int lives_left;
+			int score;
+		};
+
+		uint32_t tick{};
+		std::vector<Player> players;
+
+		const Player* find(SESSION_ID sid) const {
+			auto it = std::find_if(players.begin(), players.end(), [sid](const Player& p) { return p.sid == sid; });
+			return it == players.end() ? nullptr : &*it;
+		}
 	};
 
+	// latest published state, stays valid for as long as the caller holds it
+	std::shared_ptr<const Published> published() const { return std::atomic_load(&published_state); }
+
+	/**
+	 * copies the players out of data and swaps them in for readers. data_mutex must be held.
+	 *
+	 */
+	void publish();
+
 	class Data {
 	public:
-		Data() : last_updated{ std::chrono::high_resolution_clock::now() } {};
+		Spaceships spaceships{};
+		Bullets bullets{};
+		Asteroids asteroids{};
+		EntityIds ids;
 
-		std::vector<Spaceship> spaceships{};
-		std::vector<Bullet> bullets{};
-		std::vector<Asteroid> asteroids{};
-		decltype(std::chrono::high_resolution_clock::now()) last_updated;
-
-		std::vector<char> toBytes();
+		uint32_t tick{};					// simulation steps since the game started
+		uint32_t last_asteroid_spawn_tick{};
+		uint32_t seed{ newSeed() };		// logged when the match starts, the same seed and inputs replay the same match
+		std::mt19937 rng{ seed };			// all game randomness, reseeded on reset
 
+		// back to the start of a match with a new seed
 		void reset();
 
+		/**
+		 * back to the start of a match that replays seed.
+		 *
+		 * \param seed
+		 */
+		void reset(uint32_t seed);
+
+		static uint32_t newSeed();
+
+		/**
+		 * removes the spaceship of sid, if any, and releases its id.
+		 *
+		 * \param sid
+		 */
+		void removeSpaceship(SESSION_ID sid);
+
 		//void resetSpaceship(SESSION_ID sid);
-		void killSpaceship(std::vector<Spaceship>::iterator& it);
+		void killSpaceship(size_t i);
 	};
 
 	Data data;
@@ -149,7 +363,7 @@ public:
 	static constexpr int NUM_HIGHSCORES = 5;
 
 	/**
-	 * use on a separate thread.
+	 * runs the match until it ends or the server stops. called by run.
 	 * 
 	 */
 	void updateGame();
@@ -160,7 +374,84 @@ public:
 		float radius;
 	};
 
-	bool circleCollision(Circle c1, Circle c2);
+	/**
+	 * circle overlap on the toroidal world asteroids wrap in, -WINDOW_WIDTH..WINDOW_WIDTH
+	 * and -WINDOW_HEIGHT..WINDOW_HEIGHT.
+	 *
+	 * \param c1
+	 * \param c2
+	 * \return
+	 */
+	static bool circleCollision(Circle c1, Circle c2);
+
+	/**
+	 * tick scheduling stats.
+	 *
+	 * \param os
+	 */
+	void printStats(std::ostream& os) const;
+
+	/**
+	 * times moving entities stored as arrays (Bodies) against the old array of structs layout.
+	 *
+	 * \param os
+	 */
+	static void benchmark(std::ostream& os);
+
+private:
+	// swapped atomically by publish, the old copy is freed by its last reader
+	std::shared_ptr<const Published> published_state = std::make_shared<const Published>();
+
+	// written under state_mutex so that waiters on state_cv do not miss a change
+	std::atomic<MatchState> match_state{ MatchState::LOBBY };
+	std::atomic<bool> stopping{ false };
+	std::mutex state_mutex;
+	std::condition_variable state_cv;
+
+	// wakes updateGame up every TICK_DURATION
+	TickScheduler ticker{ TICK_DURATION };
+
+	// collision broadphase, only touched by the game thread
+	SpatialHash broadphase{ -(float)WINDOW_WIDTH, -(float)WINDOW_HEIGHT, 2.f * WINDOW_WIDTH, 2.f * WINDOW_HEIGHT, 2.f * MAX_ASTEROID_RADIUS };
+	std::vector<char> bullet_hit;
+	std::vector<char> asteroid_hit;
+
+	// broadphase candidates of one asteroid, batched into one overlap test
+	std::vector<uint32_t> candidates;
+	std::vector<float> candidate_x, candidate_y, candidate_r;
+	std::vector<uint64_t> candidate_hits;
+
+	// inputs from the network threads, only popped by the game thread
+	MpscQueue<Input, INPUT_QUEUE_SIZE> inputs;
+
+	// spaceship index of every session, -1 if none. sessions ids are sent as 1 byte
+	std::array<int, 256> spaceship_slot;
+
+	/**
+	 * moves and wraps every entity and removes bullets that left the world.
+	 *
+	 * \param d
+	 * \param dt seconds
+	 */
+	static void moveEntities(Data& d, float dt);
+
+	/**
+	 * advances the simulation by one tick of TICK_DT. data_mutex must be held.
+	 *
+	 */
+	void step();
+
+	/**
+	 * applies every queued input to data. data_mutex must be held.
+	 *
+	 */
+	void applyInputs();
+
+	/**
+	 * asteroid against bullet and spaceship collisions of one tick. call with data_mutex held.
+	 *
+	 */
+	void checkCollisions();
 };
 
 #endif // __GAME_H__
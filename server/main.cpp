@@ -16,6 +16,11 @@ prior written consent of DigiPen Institute of Technology is prohibited.
 
 #include "server.h"
 #include "game.h"
+#include "reliable.h"
+#include "motion.h"
+#include "overlap.h"
+#include "pipeline.h"
+#include "buffer.h"
 
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -28,35 +33,50 @@ int main()
 	int serverExitCode = s.init();
 
 	std::thread recvthread([&s]() { s.udpListener(); });
-	std::thread gameUpdateThread([&]() { 
-		while (Game::getInstance().gameThreadRunning) {
-			Game::getInstance().updateGame();
-		}
-		}
-	);
+	std::thread gameUpdateThread([]() { Game::getInstance().run(); });
 	std::thread reqHandlerThread([&s]() {s.requestHandler(); });
 	std::thread keepAliveCheckingThread([&s]() {s.keepAliveChecker(); });
-	std::thread threadpoolManagerThread(Server::threadpoolManager);
+	std::thread reliableSenderThread([]() { ReliableSender::getInstance().run(); });
+	std::thread snapshotEncoderThread([]() { SnapshotPipeline::getInstance().runEncoder(); });
+	std::thread snapshotSenderThread([]() { SnapshotPipeline::getInstance().runSender(); });
 
 	auto quitServerListener = []() {
-		// quit server if `q` is received
+		// quit server if `q` is received, print stats on `stats`, run the benchmarks on `bench`
 
 		std::string ln;
 
-		while (ln != "q")
+		while (ln != "q") {
 			std::getline(std::cin, ln);
+
+			if (ln == "stats")
+				Server::getInstance().printStats();
+			else if (ln == "bench") {
+				std::ostringstream os;
+				SpatialHash::benchmark(os);
+				Game::benchmark(os);
+				Motion::benchmark(os);
+				Overlap::benchmark(os);
+				PacketCodec::benchmark(os);
+
+				std::lock_guard<std::mutex> stdoutlock(Server::getInstance()._stdoutMutex);
+				std::cout << os.str();
+			}
+		}
 		};
 	quitServerListener();
 
 	s.udpListenerRunning = false;
-	Game::getInstance().gameRunning = false;
-	Game::getInstance().gameThreadRunning = false;
+	Game::getInstance().stop();
+	ReliableSender::getInstance().stop();
+	SnapshotPipeline::getInstance().stop();
 
 	recvthread.join();
 	gameUpdateThread.join();
 	reqHandlerThread.join();
 	keepAliveCheckingThread.join();
-	threadpoolManagerThread.join();
+	reliableSenderThread.join();
+	snapshotEncoderThread.join();
+	snapshotSenderThread.join();
 
 	s.cleanup();
 
@@ -0,0 +1,332 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file motion.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the vectorized entity motion kernels
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "motion.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#ifdef MOTION_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+	// scalar kernels, also finish the elements left over by the vector kernels
+
+	void integrateWrappedScalar(float* x, float* y, const float* vx, const float* vy, size_t begin, size_t n, float dt, const Motion::Bounds& w) {
+		for (size_t i = begin; i < n; i++) {
+			const float nx = x[i] + vx[i] * dt;
+			const float ny = y[i] + vy[i] * dt;
+			x[i] = nx < w.min_x ? w.max_x : (nx > w.max_x ? w.min_x : nx);
+			y[i] = ny < w.min_y ? w.max_y : (ny > w.max_y ? w.min_y : ny);
+		}
+	}
+
+	size_t integrateCulledScalar(float* x, float* y, const float* vx, const float* vy, size_t begin, size_t n, float dt, const Motion::Bounds& b, char* outside) {
+		size_t count{};
+		for (size_t i = begin; i < n; i++) {
+			const float nx = x[i] + vx[i] * dt;
+			const float ny = y[i] + vy[i] * dt;
+			x[i] = nx;
+			y[i] = ny;
+			outside[i] = (nx > b.max_x) | (nx < b.min_x) | (ny > b.max_y) | (ny < b.min_y);
+			count += outside[i];
+		}
+		return count;
+	}
+
+#ifdef MOTION_X86
+	// compare mask (movemask bits) to one 0/1 flag byte per element, and the number of set bits
+	struct MaskTable {
+		uint64_t bytes[256];
+		uint8_t count[256];
+
+		constexpr MaskTable() : bytes{}, count{} {
+			for (int m{}; m < 256; m++) {
+				for (int k{}; k < 8; k++) {
+					if (m & (1 << k)) {
+						bytes[m] |= (uint64_t)1 << (8 * k);
+						count[m]++;
+					}
+				}
+			}
+		}
+	};
+	constexpr MaskTable mask_table{};
+
+	// little endian, byte k of the table entry is element k
+	inline size_t storeFlags(char* outside, int bits, size_t lanes) {
+		const uint64_t flags = mask_table.bytes[bits];
+		std::memcpy(outside, &flags, lanes);
+		return mask_table.count[bits];
+	}
+
+	// 4 floats at a time, SSE2 is always there on x64
+
+	// mask ? a : b
+	inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	inline __m128 wrap(__m128 v, __m128 min, __m128 max) {
+		const __m128 r = select(_mm_cmpgt_ps(v, max), min, v);
+		return select(_mm_cmplt_ps(v, min), max, r);
+	}
+
+	void integrateWrappedSse2(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Motion::Bounds& w) {
+		const __m128 vdt = _mm_set1_ps(dt);
+		const __m128 min_x = _mm_set1_ps(w.min_x), max_x = _mm_set1_ps(w.max_x);
+		const __m128 min_y = _mm_set1_ps(w.min_y), max_y = _mm_set1_ps(w.max_y);
+
+		size_t i{};
+		for (; i + 4 <= n; i += 4) {
+			const __m128 nx = _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), vdt));
+			const __m128 ny = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), vdt));
+			_mm_storeu_ps(x + i, wrap(nx, min_x, max_x));
+			_mm_storeu_ps(y + i, wrap(ny, min_y, max_y));
+		}
+		integrateWrappedScalar(x, y, vx, vy, i, n, dt, w);
+	}
+
+	size_t integrateCulledSse2(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Motion::Bounds& b, char* outside) {
+		const __m128 vdt = _mm_set1_ps(dt);
+		const __m128 min_x = _mm_set1_ps(b.min_x), max_x = _mm_set1_ps(b.max_x);
+		const __m128 min_y = _mm_set1_ps(b.min_y), max_y = _mm_set1_ps(b.max_y);
+
+		size_t count{};
+		size_t i{};
+		for (; i + 4 <= n; i += 4) {
+			const __m128 nx = _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), vdt));
+			const __m128 ny = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), vdt));
+			_mm_storeu_ps(x + i, nx);
+			_mm_storeu_ps(y + i, ny);
+
+			const __m128 out = _mm_or_ps(
+				_mm_or_ps(_mm_cmpgt_ps(nx, max_x), _mm_cmplt_ps(nx, min_x)),
+				_mm_or_ps(_mm_cmpgt_ps(ny, max_y), _mm_cmplt_ps(ny, min_y)));
+			count += storeFlags(outside + i, _mm_movemask_ps(out), 4);
+		}
+		return count + integrateCulledScalar(x, y, vx, vy, i, n, dt, b, outside);
+	}
+
+	// 8 floats at a time
+
+	MOTION_TARGET_AVX2 inline __m256 wrap256(__m256 v, __m256 min, __m256 max) {
+		const __m256 r = _mm256_blendv_ps(v, min, _mm256_cmp_ps(v, max, _CMP_GT_OQ));
+		return _mm256_blendv_ps(r, max, _mm256_cmp_ps(v, min, _CMP_LT_OQ));
+	}
+
+	MOTION_TARGET_AVX2 void integrateWrappedAvx2(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Motion::Bounds& w) {
+		const __m256 vdt = _mm256_set1_ps(dt);
+		const __m256 min_x = _mm256_set1_ps(w.min_x), max_x = _mm256_set1_ps(w.max_x);
+		const __m256 min_y = _mm256_set1_ps(w.min_y), max_y = _mm256_set1_ps(w.max_y);
+
+		size_t i{};
+		for (; i + 8 <= n; i += 8) {
+			const __m256 nx = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), vdt));
+			const __m256 ny = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), vdt));
+			_mm256_storeu_ps(x + i, wrap256(nx, min_x, max_x));
+			_mm256_storeu_ps(y + i, wrap256(ny, min_y, max_y));
+		}
+		// the scalar tail is legacy SSE, clear the upper halves to avoid the AVX to SSE transition penalty
+		_mm256_zeroupper();
+		integrateWrappedScalar(x, y, vx, vy, i, n, dt, w);
+	}
+
+	MOTION_TARGET_AVX2 size_t integrateCulledAvx2(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Motion::Bounds& b, char* outside) {
+		const __m256 vdt = _mm256_set1_ps(dt);
+		const __m256 min_x = _mm256_set1_ps(b.min_x), max_x = _mm256_set1_ps(b.max_x);
+		const __m256 min_y = _mm256_set1_ps(b.min_y), max_y = _mm256_set1_ps(b.max_y);
+
+		size_t count{};
+		size_t i{};
+		for (; i + 8 <= n; i += 8) {
+			const __m256 nx = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), vdt));
+			const __m256 ny = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), vdt));
+			_mm256_storeu_ps(x + i, nx);
+			_mm256_storeu_ps(y + i, ny);
+
+			const __m256 out = _mm256_or_ps(
+				_mm256_or_ps(_mm256_cmp_ps(nx, max_x, _CMP_GT_OQ), _mm256_cmp_ps(nx, min_x, _CMP_LT_OQ)),
+				_mm256_or_ps(_mm256_cmp_ps(ny, max_y, _CMP_GT_OQ), _mm256_cmp_ps(ny, min_y, _CMP_LT_OQ)));
+			count += storeFlags(outside + i, _mm256_movemask_ps(out), 8);
+		}
+		_mm256_zeroupper();
+		return count + integrateCulledScalar(x, y, vx, vy, i, n, dt, b, outside);
+	}
+
+	bool cpuHasAvx2() {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+
+		// the os must save the ymm registers too
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif // MOTION_X86
+}
+
+bool Motion::supported(Isa isa) {
+	switch (isa) {
+	case Isa::SCALAR:
+		return true;
+#ifdef MOTION_X86
+	case Isa::SSE2:
+		return true;
+	case Isa::AVX2: {
+		static const bool avx2 = cpuHasAvx2();
+		return avx2;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+Motion::Isa Motion::active() {
+	static const Isa isa = supported(Isa::AVX2) ? Isa::AVX2 : (supported(Isa::SSE2) ? Isa::SSE2 : Isa::SCALAR);
+	return isa;
+}
+
+const char* Motion::name(Isa isa) {
+	switch (isa) {
+	case Isa::SSE2: return "sse2";
+	case Isa::AVX2: return "avx2";
+	default: return "scalar";
+	}
+}
+
+void Motion::integrateWrapped(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Bounds& wrap, Isa isa) {
+	switch (isa) {
+#ifdef MOTION_X86
+	case Isa::AVX2:
+		integrateWrappedAvx2(x, y, vx, vy, n, dt, wrap);
+		return;
+	case Isa::SSE2:
+		integrateWrappedSse2(x, y, vx, vy, n, dt, wrap);
+		return;
+#endif
+	default:
+		integrateWrappedScalar(x, y, vx, vy, 0, n, dt, wrap);
+		return;
+	}
+}
+
+size_t Motion::integrateCulled(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Bounds& bounds, char* outside, Isa isa) {
+	switch (isa) {
+#ifdef MOTION_X86
+	case Isa::AVX2:
+		return integrateCulledAvx2(x, y, vx, vy, n, dt, bounds, outside);
+	case Isa::SSE2:
+		return integrateCulledSse2(x, y, vx, vy, n, dt, bounds, outside);
+#endif
+	default:
+		return integrateCulledScalar(x, y, vx, vy, 0, n, dt, bounds, outside);
+	}
+}
+
+bool Motion::benchmark(std::ostream& os) {
+	static constexpr float dt = 1.f / 120;
+	static constexpr Bounds world{ -1600.f, 1600.f, -900.f, 900.f };
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> pos_x(world.min_x, world.max_x);
+	std::uniform_real_distribution<float> pos_y(world.min_y, world.max_y);
+	std::uniform_real_distribution<float> speed(-2000.f, 2000.f);	// fast enough to wrap and cull often
+
+	os << "motion kernels, active " << name(active()) << ", integrate+wrap / integrate+cull time per tick" << std::endl;
+
+	bool all_exact = true;
+	for (int n : { 10, 100, 1000, 10000 }) {
+		std::vector<float> x0(n), y0(n), vx(n), vy(n);
+		for (int i{}; i < n; i++) {
+			x0[i] = pos_x(rng);
+			y0[i] = pos_y(rng);
+			vx[i] = speed(rng);
+			vy[i] = speed(rng);
+		}
+
+		// one batch is ~2M entity updates
+		const int reps = std::max(1, 2000000 / n);
+
+		// scalar results are the reference
+		std::vector<float> ref_x, ref_y, ref_cx, ref_cy;
+		std::vector<char> ref_out;
+		size_t ref_count{};
+
+		os << "n=" << std::setw(5) << n;
+		for (Isa isa : { Isa::SCALAR, Isa::SSE2, Isa::AVX2 }) {
+			if (!supported(isa)) {
+				continue;
+			}
+
+			std::vector<float> x = x0, y = y0;
+			const double wrap_us = bestOf(reps, [&]() {
+				integrateWrapped(x.data(), y.data(), vx.data(), vy.data(), n, dt, world, isa);
+			});
+
+			// cull keeps moving culled entities, it only reports them
+			std::vector<float> cx = x0, cy = y0;
+			std::vector<char> out(n);
+			size_t count{};
+			const double cull_us = bestOf(reps, [&]() {
+				count = integrateCulled(cx.data(), cy.data(), vx.data(), vy.data(), n, dt, world, out.data(), isa);
+			});
+
+			bool exact = true;
+			if (isa == Isa::SCALAR) {
+				ref_x = x; ref_y = y; ref_cx = cx; ref_cy = cy; ref_out = out; ref_count = count;
+			}
+			else {
+				exact = std::memcmp(x.data(), ref_x.data(), n * sizeof(float)) == 0
+					&& std::memcmp(y.data(), ref_y.data(), n * sizeof(float)) == 0
+					&& std::memcmp(cx.data(), ref_cx.data(), n * sizeof(float)) == 0
+					&& std::memcmp(cy.data(), ref_cy.data(), n * sizeof(float)) == 0
+					&& out == ref_out && count == ref_count;
+				all_exact = all_exact && exact;
+			}
+
+			os << " " << name(isa) << "=" << std::fixed << std::setprecision(2)
+				<< wrap_us << "/" << cull_us << "us" << std::defaultfloat
+				<< (exact ? "" : " MISMATCH");
+		}
+		os << std::endl;
+	}
+	os << "motion kernels " << (all_exact ? "match the scalar path bit for bit" : "DO NOT match the scalar path") << std::endl;
+	return all_exact;
+}
@@ -0,0 +1,103 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file motion.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the vectorized entity motion kernels
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __MOTION_H__
+#define __MOTION_H__
+
+#include <cstddef>
+#include <ostream>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MOTION_X86
+#endif
+
+// msvc compiles any intrinsic, gcc and clang need avx2 enabled per function
+#if defined(MOTION_X86) && !defined(_MSC_VER)
+#define MOTION_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MOTION_TARGET_AVX2
+#endif
+
+/**
+ * integrates whole position arrays per tick.
+ *
+ * every kernel has a scalar, SSE2 and AVX2 version that give bit identical results: the
+ * same multiply then add per element (no fused multiply add), and wrapping/culling done
+ * with compares and selects instead of branches. the best version the cpu supports is
+ * picked once at runtime, non x86 builds always use the scalar one.
+ */
+class Motion {
+public:
+	enum class Isa {
+		SCALAR,
+		SSE2,
+		AVX2,
+	};
+
+	struct Bounds {
+		float min_x, max_x;
+		float min_y, max_y;
+	};
+
+	// best isa supported by this cpu, detected on first use
+	static Isa active();
+
+	static bool supported(Isa isa);
+
+	static const char* name(Isa isa);
+
+	/**
+	 * pos += vel * dt, then a position below min becomes max and above max becomes min.
+	 *
+	 * \param x
+	 * \param y
+	 * \param vx
+	 * \param vy
+	 * \param n
+	 * \param dt seconds
+	 * \param wrap
+	 * \param isa
+	 */
+	static void integrateWrapped(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Bounds& wrap, Isa isa = active());
+
+	/**
+	 * pos += vel * dt, then flags every position outside bounds (limits are inside).
+	 *
+	 * \param x
+	 * \param y
+	 * \param vx
+	 * \param vy
+	 * \param n
+	 * \param dt seconds
+	 * \param bounds
+	 * \param outside n flags, 1 if outside
+	 * \param isa
+	 * \return number of positions outside
+	 */
+	static size_t integrateCulled(float* x, float* y, const float* vx, const float* vy, size_t n, float dt, const Bounds& bounds, char* outside, Isa isa = active());
+
+	/**
+	 * times every supported isa for 10 to 10k entities and checks they match the scalar kernels bit for bit.
+	 *
+	 * \param os
+	 * \return false on a mismatch
+	 */
+	static bool benchmark(std::ostream& os);
+};
+
+#endif // __MOTION_H__
@@ -0,0 +1,119 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file mpscqueue.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the lock free queue that hands work to a single consumer thread
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __MPSCQUEUE_H__
+#define __MPSCQUEUE_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * multi producer single consumer ring of CAPACITY values, allocated inline.
+ *
+ * every slot carries a sequence number telling whose turn it is: producers claim a slot by
+ * moving tail forward with a compare exchange, then publish the value by bumping the
+ * slot's sequence. the consumer only reads slots whose sequence says they are published,
+ * so a producer that stalls mid push never exposes a half written value.
+ *
+ * when the ring is full the new value is dropped, like PacketQueue.
+ */
+template <typename T, int CAPACITY>
+class MpscQueue {
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+	MpscQueue() {
+		for (uint64_t i{}; i < CAPACITY; i++) {
+			slots[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	/**
+	 * any thread.
+	 *
+	 * \param value
+	 * \return false if the queue was full and value was dropped
+	 */
+	bool push(const T& value) {
+		uint64_t t = tail.load(std::memory_order_relaxed);
+
+		for (;;) {
+			Slot& s = slots[t % CAPACITY];
+			const int64_t turn = (int64_t)(s.seq.load(std::memory_order_acquire) - t);
+
+			if (turn == 0) {
+				// free slot, claim it
+				if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+					s.value = value;
+					s.seq.store(t + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (turn < 0) {
+				// slot still holds a value from the previous lap, the consumer is behind
+				num_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else {
+				// another producer claimed it first
+				t = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * consumer only.
+	 *
+	 * \param value oldest value, if any
+	 * \return false if empty
+	 */
+	bool pop(T& value) {
+		Slot& s = slots[head % CAPACITY];
+		if (s.seq.load(std::memory_order_acquire) != head + 1) {
+			return false;
+		}
+
+		value = s.value;
+
+		// free for the producer one lap ahead
+		s.seq.store(head + CAPACITY, std::memory_order_release);
+		head++;
+		return true;
+	}
+
+	uint64_t dropped() const { return num_dropped.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> seq;
+		T value;
+	};
+
+	std::array<Slot, CAPACITY> slots;
+
+	alignas(64) std::atomic<uint64_t> tail{};		// next slot to claim, shared by producers
+	alignas(64) uint64_t head{};					// next slot to read, consumer only
+
+	alignas(64) std::atomic<uint64_t> num_dropped{};
+};
+
+#endif // __MPSCQUEUE_H__
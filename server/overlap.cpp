@@ -0,0 +1,202 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file overlap.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the batched circle overlap test
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "overlap.h"
+#include "game.h"
+
+#include <cstring>
+#include <iomanip>
+#include <random>
+
+#ifdef MOTION_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+	// also finishes the circles left over by the vector kernels
+	size_t oneToManyScalar(float x, float y, float r, const float* xs, const float* ys, const float* rs, size_t begin, size_t n,
+		float half_w, float half_h, uint64_t* hits) {
+		size_t count{};
+		for (size_t i = begin; i < n; i++) {
+			float dx = x - xs[i];
+			float dy = y - ys[i];
+			dx = dx > half_w ? dx - 2.f * half_w : (dx < -half_w ? dx + 2.f * half_w : dx);
+			dy = dy > half_h ? dy - 2.f * half_h : (dy < -half_h ? dy + 2.f * half_h : dy);
+
+			const float rr = rs[i] + r;
+			if (dx * dx + dy * dy <= rr * rr) {
+				hits[i / 64] |= (uint64_t)1 << (i % 64);
+				count++;
+			}
+		}
+		return count;
+	}
+
+#ifdef MOTION_X86
+	// d - period where d > half, d + period where d < -half. adding 0 elsewhere keeps d exact
+	inline __m128 wrapOffset(__m128 d, __m128 half, __m128 neg_half, __m128 period) {
+		d = _mm_sub_ps(d, _mm_and_ps(_mm_cmpgt_ps(d, half), period));
+		return _mm_add_ps(d, _mm_and_ps(_mm_cmplt_ps(d, neg_half), period));
+	}
+
+	size_t oneToManySse2(float x, float y, float r, const float* xs, const float* ys, const float* rs, size_t n,
+		float half_w, float half_h, uint64_t* hits) {
+		const __m128 cx = _mm_set1_ps(x), cy = _mm_set1_ps(y), cr = _mm_set1_ps(r);
+		const __m128 hw = _mm_set1_ps(half_w), neg_hw = _mm_set1_ps(-half_w), pw = _mm_set1_ps(2.f * half_w);
+		const __m128 hh = _mm_set1_ps(half_h), neg_hh = _mm_set1_ps(-half_h), ph = _mm_set1_ps(2.f * half_h);
+
+		size_t count{};
+		size_t i{};
+		for (; i + 4 <= n; i += 4) {
+			const __m128 dx = wrapOffset(_mm_sub_ps(cx, _mm_loadu_ps(xs + i)), hw, neg_hw, pw);
+			const __m128 dy = wrapOffset(_mm_sub_ps(cy, _mm_loadu_ps(ys + i)), hh, neg_hh, ph);
+			const __m128 rr = _mm_add_ps(_mm_loadu_ps(rs + i), cr);
+			const __m128 dsq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+			// i is a multiple of 4, the 4 bits never straddle two words
+			const uint64_t bits = (uint64_t)_mm_movemask_ps(_mm_cmple_ps(dsq, _mm_mul_ps(rr, rr)));
+			hits[i / 64] |= bits << (i % 64);
+			count += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + (bits >> 3);
+		}
+		return count + oneToManyScalar(x, y, r, xs, ys, rs, i, n, half_w, half_h, hits);
+	}
+
+	MOTION_TARGET_AVX2 inline __m256 wrapOffset256(__m256 d, __m256 half, __m256 neg_half, __m256 period) {
+		d = _mm256_sub_ps(d, _mm256_and_ps(_mm256_cmp_ps(d, half, _CMP_GT_OQ), period));
+		return _mm256_add_ps(d, _mm256_and_ps(_mm256_cmp_ps(d, neg_half, _CMP_LT_OQ), period));
+	}
+
+	MOTION_TARGET_AVX2 size_t oneToManyAvx2(float x, float y, float r, const float* xs, const float* ys, const float* rs, size_t n,
+		float half_w, float half_h, uint64_t* hits) {
+		const __m256 cx = _mm256_set1_ps(x), cy = _mm256_set1_ps(y), cr = _mm256_set1_ps(r);
+		const __m256 hw = _mm256_set1_ps(half_w), neg_hw = _mm256_set1_ps(-half_w), pw = _mm256_set1_ps(2.f * half_w);
+		const __m256 hh = _mm256_set1_ps(half_h), neg_hh = _mm256_set1_ps(-half_h), ph = _mm256_set1_ps(2.f * half_h);
+
+		size_t count{};
+		size_t i{};
+		for (; i + 8 <= n; i += 8) {
+			const __m256 dx = wrapOffset256(_mm256_sub_ps(cx, _mm256_loadu_ps(xs + i)), hw, neg_hw, pw);
+			const __m256 dy = wrapOffset256(_mm256_sub_ps(cy, _mm256_loadu_ps(ys + i)), hh, neg_hh, ph);
+			const __m256 rr = _mm256_add_ps(_mm256_loadu_ps(rs + i), cr);
+			const __m256 dsq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+			// i is a multiple of 8, the 8 bits never straddle two words
+			const uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(dsq, _mm256_mul_ps(rr, rr), _CMP_LE_OQ));
+			hits[i / 64] |= (uint64_t)bits << (i % 64);
+			count += _mm_popcnt_u32(bits);
+		}
+
+		// the scalar tail is legacy SSE, clear the upper halves to avoid the AVX to SSE transition penalty
+		_mm256_zeroupper();
+		return count + oneToManyScalar(x, y, r, xs, ys, rs, i, n, half_w, half_h, hits);
+	}
+#endif // MOTION_X86
+}
+
+size_t Overlap::oneToMany(float x, float y, float r, const float* xs, const float* ys, const float* rs, size_t n,
+	float half_w, float half_h, uint64_t* hits, Motion::Isa isa) {
+	std::memset(hits, 0, words(n) * sizeof(uint64_t));
+
+	switch (isa) {
+#ifdef MOTION_X86
+	case Motion::Isa::AVX2:
+		return oneToManyAvx2(x, y, r, xs, ys, rs, n, half_w, half_h, hits);
+	case Motion::Isa::SSE2:
+		return oneToManySse2(x, y, r, xs, ys, rs, n, half_w, half_h, hits);
+#endif
+	default:
+		return oneToManyScalar(x, y, r, xs, ys, rs, 0, n, half_w, half_h, hits);
+	}
+}
+
+bool Overlap::benchmark(std::ostream& os) {
+	const float half_w = (float)Game::WINDOW_WIDTH;
+	const float half_h = (float)Game::WINDOW_HEIGHT;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> pos_x(-half_w, half_w);
+	std::uniform_real_distribution<float> pos_y(-half_h, half_h);
+	std::uniform_real_distribution<float> radius((float)Game::MIN_ASTEROID_RADIUS, (float)Game::MAX_ASTEROID_RADIUS);
+
+	os << "circle overlap, asteroids x bullets all pairs, pairwise Game::circleCollision against oneToMany per asteroid" << std::endl;
+
+	bool all_match = true;
+
+	// realistic is a full match, the rest is stress
+	const std::pair<int, int> sizes[] = { { Game::MAX_ASTEROIDS, 64 }, { 100, 1000 }, { 1000, 1000 }, { 5000, 5000 } };
+	for (const auto& [num_asteroids, num_bullets] : sizes) {
+		std::vector<Game::Circle> asteroids, bullets;
+		std::vector<float> bx, by, br;
+		for (int i{}; i < num_asteroids; i++) {
+			asteroids.push_back({ { pos_x(rng), pos_y(rng) }, radius(rng) });
+		}
+		for (int i{}; i < num_bullets; i++) {
+			bullets.push_back({ { pos_x(rng), pos_y(rng) }, Game::BULLET_RADIUS });
+			bx.push_back(bullets.back().pos.x);
+			by.push_back(bullets.back().pos.y);
+			br.push_back(bullets.back().radius);
+		}
+		std::vector<uint64_t> hits(words(num_bullets));
+
+		// one batch is ~10M pairs
+		const int reps = std::max(1, 10000000 / (num_asteroids * num_bullets));
+
+		// reference, the pairwise function. pair index a * num_bullets + b is recorded for comparison
+		std::vector<uint64_t> ref_pairs;
+		const double pairwise_us = bestOf(reps, [&]() {
+			ref_pairs.clear();
+			for (int a{}; a < num_asteroids; a++) {
+				for (int b{}; b < num_bullets; b++) {
+					if (Game::circleCollision(bullets[b], asteroids[a])) {
+						ref_pairs.push_back((uint64_t)a * num_bullets + b);
+					}
+				}
+			}
+		});
+
+		os << num_asteroids << "x" << num_bullets << std::fixed << std::setprecision(2)
+			<< ": pairwise=" << pairwise_us << "us";
+
+		for (Motion::Isa isa : { Motion::Isa::SCALAR, Motion::Isa::SSE2, Motion::Isa::AVX2 }) {
+			if (!Motion::supported(isa)) {
+				continue;
+			}
+
+			std::vector<uint64_t> pairs;
+			const double batch_us = bestOf(reps, [&]() {
+				pairs.clear();
+				for (int a{}; a < num_asteroids; a++) {
+					const Game::Circle& c = asteroids[a];
+					if (oneToMany(c.pos.x, c.pos.y, c.radius, bx.data(), by.data(), br.data(), num_bullets, half_w, half_h, hits.data(), isa) == 0) {
+						continue;
+					}
+					for (int b{}; b < num_bullets; b++) {
+						if (hits[b / 64] >> (b % 64) & 1) {
+							pairs.push_back((uint64_t)a * num_bullets + b);
+						}
+					}
+				}
+			});
+
+			const bool match = pairs == ref_pairs;
+			all_match = all_match && match;
+			os << " " << Motion::name(isa) << "=" << batch_us << "us" << (match ? "" : " MISMATCH");
+		}
+		os << std::defaultfloat << " (" << ref_pairs.size() << " overlaps)" << std::endl;
+	}
+	os << "circle overlap kernels " << (all_match ? "match Game::circleCollision" : "DO NOT match Game::circleCollision") << std::endl;
+	return all_match;
+}
@@ -0,0 +1,65 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file overlap.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the batched circle overlap test
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __OVERLAP_H__
+#define __OVERLAP_H__
+
+#include "motion.h"
+
+#include <cstdint>
+
+/**
+ * tests one circle against many on a toroidal world, 4 or 8 circles per instruction.
+ *
+ * matches Game::circleCollision bit for bit: the offset is wrapped to the shortest
+ * distance across the world, then dx * dx + dy * dy <= (r1 + r2) * (r1 + r2).
+ * uses the same isa dispatch as Motion.
+ */
+class Overlap {
+public:
+	// 64 circles per word of the hit mask
+	static constexpr size_t words(size_t n) { return (n + 63) / 64; }
+
+	/**
+	 * \param x circle to test
+	 * \param y
+	 * \param r
+	 * \param xs n circles to test against
+	 * \param ys
+	 * \param rs
+	 * \param n
+	 * \param half_w half the world width, offsets beyond it are wrapped
+	 * \param half_h half the world height
+	 * \param hits words(n) words, bit i % 64 of word i / 64 is set if circle i overlaps
+	 * \param isa
+	 * \return number of overlapping circles
+	 */
+	static size_t oneToMany(float x, float y, float r, const float* xs, const float* ys, const float* rs, size_t n,
+		float half_w, float half_h, uint64_t* hits, Motion::Isa isa = Motion::active());
+
+	/**
+	 * times Game::circleCollision pair by pair against oneToMany with every supported isa,
+	 * for realistic and stress entity counts, and checks they find the same overlaps.
+	 *
+	 * \param os
+	 * \return false on a mismatch
+	 */
+	static bool benchmark(std::ostream& os);
+};
+
+#endif // __OVERLAP_H__
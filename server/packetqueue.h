@@ -0,0 +1,121 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file packetqueue.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the bounded receive queue between udpListener and
+requestHandler
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __PACKETQUEUE_H__
+#define __PACKETQUEUE_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+/**
+ * single producer single consumer ring of fixed size packet slots.
+ * all slots are allocated once on construction, push only copies the received bytes.
+ *
+ * when the ring is full the newest packet is dropped. the producer never touches a slot
+ * that the consumer may still be reading, which drop-oldest would require.
+ */
+template <typename ADDR, int SLOT_SIZE, int CAPACITY>
+class PacketQueue {
+public:
+	struct Packet {
+		ADDR addr;
+		int len;
+		std::chrono::steady_clock::time_point recv_time;	// when the packet was queued
+		char data[SLOT_SIZE];
+	};
+
+	PacketQueue() : slots(CAPACITY) {}
+
+	PacketQueue(const PacketQueue&) = delete;
+	PacketQueue& operator=(const PacketQueue&) = delete;
+
+	/**
+	 * producer only.
+	 *
+	 * \param addr
+	 * \param buf
+	 * \param len
+	 * \return false if the packet was dropped
+	 */
+	bool push(const ADDR& addr, const char* buf, int len) {
+		const uint64_t t = tail.load(std::memory_order_relaxed);
+
+		if (t - head.load(std::memory_order_acquire) >= CAPACITY) {
+			num_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		if (len > SLOT_SIZE) {
+			num_truncated.fetch_add(1, std::memory_order_relaxed);
+			len = SLOT_SIZE;
+		}
+
+		Packet& p = slots[t % CAPACITY];
+		p.addr = addr;
+		p.len = len;
+		p.recv_time = std::chrono::steady_clock::now();
+		std::memcpy(p.data, buf, len);
+
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * consumer only. the packet stays valid until pop().
+	 *
+	 * \return oldest packet, nullptr if empty
+	 */
+	Packet* front() {
+		const uint64_t h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		return &slots[h % CAPACITY];
+	}
+
+	/**
+	 * consumer only. releases the slot returned by front().
+	 *
+	 */
+	void pop() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	uint64_t size() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+	uint64_t dropped() const { return num_dropped.load(std::memory_order_relaxed); }
+	uint64_t truncated() const { return num_truncated.load(std::memory_order_relaxed); }
+
+private:
+	std::vector<Packet> slots;
+
+	alignas(64) std::atomic<uint64_t> head{};		// next slot to read, written by consumer
+	alignas(64) std::atomic<uint64_t> tail{};		// next slot to write, written by producer
+
+	alignas(64) std::atomic<uint64_t> num_dropped{};
+	std::atomic<uint64_t> num_truncated{};
+};
+
+#endif // __PACKETQUEUE_H__
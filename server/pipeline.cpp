@@ -0,0 +1,126 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file pipeline.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the snapshot pipeline between the simulation and the network
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "pipeline.h"
+
+namespace {
+	uint64_t microseconds(SnapshotPipeline::Clock::duration d) {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+	}
+}
+
+SnapshotPipeline::SnapshotPipeline() {
+	for (int i{}; i < NUM_FRAMES; i++) {
+		frames[i].payload.reserve(Server::MAX_PACKET_SIZE);
+		free_frames.push(i);
+	}
+}
+
+SnapshotPipeline& SnapshotPipeline::getInstance() {
+	static SnapshotPipeline instance;
+	return instance;
+}
+
+bool SnapshotPipeline::publish(const Game::Data& data) {
+	int i;
+	if (!free_frames.pop(i)) {
+		num_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Frame& frame = frames[i];
+	frame.captured = Clock::now();
+	SnapshotEncoder::capture(data, frame.state);
+	capture_time.record(microseconds(Clock::now() - frame.captured));
+
+	handOff(to_encode, encode_cv, i);
+	return true;
+}
+
+void SnapshotPipeline::runEncoder() {
+	for (int i; (i = waitFor(to_encode, encode_cv)) >= 0;) {
+		Frame& frame = frames[i];
+
+		const auto start = Clock::now();
+		encode_wait.record(microseconds(start - frame.captured));
+
+		const bool fits = SnapshotEncoder::getInstance().encode(frame.state, frame.payload);
+
+		frame.encoded = Clock::now();
+		encode_time.record(microseconds(frame.encoded - start));
+
+		if (!fits) {
+			// counted by the encoder, nothing to send
+			free_frames.push(i);
+			continue;
+		}
+		handOff(to_send, send_cv, i);
+	}
+}
+
+void SnapshotPipeline::runSender() {
+	for (int i; (i = waitFor(to_send, send_cv)) >= 0;) {
+		Frame& frame = frames[i];
+
+		const auto start = Clock::now();
+		send_wait.record(microseconds(start - frame.encoded));
+
+		Server::getInstance().broadcastData(frame.payload);
+
+		const auto sent = Clock::now();
+		send_time.record(microseconds(sent - start));
+		capture_to_sent.record(microseconds(sent - frame.captured));
+
+		// free_frames has room for every frame
+		free_frames.push(i);
+	}
+}
+
+void SnapshotPipeline::stop() {
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stopping = true;
+	}
+	encode_cv.notify_all();
+	send_cv.notify_all();
+}
+
+int SnapshotPipeline::waitFor(MpscQueue<int, NUM_FRAMES>& queue, std::condition_variable& cv) {
+	int i = -1;
+	std::unique_lock<std::mutex> lock(wake_mutex);
+	cv.wait(lock, [&]() { return stopping || queue.pop(i); });
+	return stopping ? -1 : i;
+}
+
+void SnapshotPipeline::handOff(MpscQueue<int, NUM_FRAMES>& queue, std::condition_variable& cv, int frame) {
+	queue.push(frame);
+
+	// a stage checks its queue under wake_mutex before sleeping, taking it here means it either saw the frame or gets the notify
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+	}
+	cv.notify_one();
+}
+
+void SnapshotPipeline::printStats(std::ostream& os) const {
+	os << "snapshot pipeline: " << num_dropped.load(std::memory_order_relaxed) << " dropped (no free frame)" << std::endl;
+	capture_time.print(os, "snapshot capture");
+	encode_wait.print(os, "snapshot encode wait");
+	encode_time.print(os, "snapshot encode");
+	send_wait.print(os, "snapshot send wait");
+	send_time.print(os, "snapshot send");
+	capture_to_sent.print(os, "snapshot capture to sent");
+}
@@ -0,0 +1,116 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file pipeline.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the snapshot pipeline between the simulation and the network
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "snapshot.h"
+#include "mpscqueue.h"
+#include "stats.h"
+
+/**
+ * moves ALL_ENTITIES snapshots from the game thread to the socket in three stages:
+ *
+ *   capture (game thread, data_mutex held) -> encode (encoder thread) -> send (sender thread)
+ *
+ * the tick only copies the entities, so its length does not depend on the payload size.
+ * frames come from a fixed pool and are handed on through bounded queues, their entity
+ * arrays and payload buffers are reused. if the pool is empty the later stages are behind
+ * and the tick drops its snapshot instead of waiting, clients delta against acked
+ * snapshots so a skipped seq costs nothing.
+ */
+class SnapshotPipeline {
+private:
+	SnapshotPipeline();
+
+public:
+	static SnapshotPipeline& getInstance();
+
+	static constexpr int NUM_FRAMES = 8;		// frames captured but not sent yet, at most
+
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * captures the entities of data into a free frame and hands it to the encoder.
+	 * game thread only, with Game::data_mutex held.
+	 *
+	 * \param data
+	 * \return false if no frame was free and the snapshot was dropped
+	 */
+	bool publish(const Game::Data& data);
+
+	// encoder stage, run on its own thread
+	void runEncoder();
+
+	// sender stage, run on its own thread
+	void runSender();
+
+	// makes both stages return
+	void stop();
+
+	/**
+	 * stage latencies and drops.
+	 *
+	 * \param os
+	 */
+	void printStats(std::ostream& os) const;
+
+private:
+	struct Frame {
+		SnapshotEncoder::State state;
+		std::vector<char> payload;
+
+		Clock::time_point captured;
+		Clock::time_point encoded;
+	};
+
+	/**
+	 * blocks until queue has a frame or the pipeline stops.
+	 *
+	 * \param queue
+	 * \param cv
+	 * \return frame index, -1 when stopping
+	 */
+	int waitFor(MpscQueue<int, NUM_FRAMES>& queue, std::condition_variable& cv);
+
+	void handOff(MpscQueue<int, NUM_FRAMES>& queue, std::condition_variable& cv, int frame);
+
+	std::array<Frame, NUM_FRAMES> frames;
+
+	// every frame index is in exactly one queue or held by one stage, the queues never overflow
+	MpscQueue<int, NUM_FRAMES> free_frames;
+	MpscQueue<int, NUM_FRAMES> to_encode;
+	MpscQueue<int, NUM_FRAMES> to_send;
+
+	// the queues are lock free, the mutex only keeps a stage from missing a wake up
+	std::mutex wake_mutex;
+	std::condition_variable encode_cv;
+	std::condition_variable send_cv;
+	bool stopping{};
+
+	// stats
+	LatencyHistogram capture_time;		// tick time spent copying entities
+	LatencyHistogram encode_wait;		// captured until the encoder picked it up
+	LatencyHistogram encode_time;
+	LatencyHistogram send_wait;			// encoded until the sender picked it up
+	LatencyHistogram send_time;
+	LatencyHistogram capture_to_sent;
+	std::atomic<uint64_t> num_dropped{};
+};
+
+#endif // __PIPELINE_H__
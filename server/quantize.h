@@ -0,0 +1,121 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file quantize.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the fixed point encoding of snapshot positions,
+rotations and radii
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __QUANTIZE_H__
+#define __QUANTIZE_H__
+
+#include "game.h"
+
+/**
+ * fixed point encoding used by ALL_ENTITIES. must match asteroids/Quantize.h.
+ *
+ * positions are clamped to the world bounds and stored in 16 bits. asteroids wrap
+ * at -WINDOW_WIDTH..WINDOW_WIDTH (and the same for height), so that is the range.
+ * rotations are wrapped to 0..360 degrees and stored in 16 bits.
+ * asteroid radii are whole numbers in MIN_ASTEROID_RADIUS..MAX_ASTEROID_RADIUS and fit a byte.
+ *
+ * decode(encode(v)) is within half a step of v, see the static_asserts at the bottom.
+ */
+struct Quantize {
+	static constexpr float POS_X_MIN = -(float)Game::WINDOW_WIDTH;
+	static constexpr float POS_X_MAX = (float)Game::WINDOW_WIDTH;
+	static constexpr float POS_Y_MIN = -(float)Game::WINDOW_HEIGHT;
+	static constexpr float POS_Y_MAX = (float)Game::WINDOW_HEIGHT;
+
+	static constexpr float POS_X_STEP = (POS_X_MAX - POS_X_MIN) / UINT16_MAX;
+	static constexpr float POS_Y_STEP = (POS_Y_MAX - POS_Y_MIN) / UINT16_MAX;
+	static constexpr float ROTATION_STEP = 360.f / (UINT16_MAX + 1);
+
+	static constexpr float POS_X_MAX_ERROR = POS_X_STEP / 2;		// ~0.025px
+	static constexpr float POS_Y_MAX_ERROR = POS_Y_STEP / 2;		// ~0.014px
+	static constexpr float ROTATION_MAX_ERROR = ROTATION_STEP / 2;	// ~0.003 degrees
+
+	static constexpr uint16_t posX(float x) { return toFixed(x, POS_X_MIN, POS_X_MAX, POS_X_STEP); }
+	static constexpr uint16_t posY(float y) { return toFixed(y, POS_Y_MIN, POS_Y_MAX, POS_Y_STEP); }
+	static constexpr float posX(uint16_t q) { return POS_X_MIN + q * POS_X_STEP; }
+	static constexpr float posY(uint16_t q) { return POS_Y_MIN + q * POS_Y_STEP; }
+
+	static constexpr uint16_t rotation(float degrees) {
+		// wrap into [0, 360)
+		const long long turns = (long long)(degrees / 360.f) - (degrees < 0 ? 1 : 0);
+		const float wrapped = degrees - (float)turns * 360.f;
+		return (uint16_t)((unsigned)round(wrapped / ROTATION_STEP) & UINT16_MAX);
+	}
+	static constexpr float rotation(uint16_t q) { return q * ROTATION_STEP; }
+
+	static constexpr uint8_t radius(float r) {
+		return (uint8_t)round(clamp(r, (float)Game::MIN_ASTEROID_RADIUS, (float)Game::MAX_ASTEROID_RADIUS));
+	}
+	static constexpr float radius(uint8_t q) { return (float)q; }
+
+	// round trip errors, used to check the bounds below
+	static constexpr float posXError(float x) { return absDiff(posX(posX(x)), x); }
+	static constexpr float posYError(float y) { return absDiff(posY(posY(y)), y); }
+	static constexpr float rotationError(float degrees, float wrapped) { return absDiff(rotation(rotation(degrees)), wrapped); }
+
+private:
+	static constexpr float clamp(float v, float min, float max) {
+		return v < min ? min : (v > max ? max : v);
+	}
+
+	// std::lround is not constexpr, values here are never negative
+	static constexpr long round(float v) {
+		return (long)(v + 0.5f);
+	}
+
+	static constexpr uint16_t toFixed(float v, float min, float max, float step) {
+		return (uint16_t)round((clamp(v, min, max) - min) / step);
+	}
+
+	static constexpr float absDiff(float a, float b) {
+		return a > b ? a - b : b - a;
+	}
+};
+
+// the wire format. asteroids/Quantize.h pins the same values, change both together
+static_assert(Quantize::POS_X_MIN == -1600.f && Quantize::POS_X_MAX == 1600.f, "x range must match asteroids/Quantize.h");
+static_assert(Quantize::POS_Y_MIN == -900.f && Quantize::POS_Y_MAX == 900.f, "y range must match asteroids/Quantize.h");
+static_assert(Quantize::ROTATION_STEP == 360.f / 65536 && Quantize::radius((uint8_t)1) == 1.f, "rotation and radius steps must match asteroids/Quantize.h");
+
+// error bounds. the 1% slack covers float rounding in decode
+static_assert(Game::MAX_ASTEROID_RADIUS <= UINT8_MAX, "asteroid radius does not fit a byte");
+static_assert(Quantize::POS_X_MAX_ERROR < 1.f / 32 && Quantize::POS_Y_MAX_ERROR < 1.f / 32, "position error above 1/32 px");
+
+static_assert(Quantize::posXError(0.f) <= Quantize::POS_X_MAX_ERROR * 1.01f, "x error above half a step");
+static_assert(Quantize::posXError(123.456f) <= Quantize::POS_X_MAX_ERROR * 1.01f, "x error above half a step");
+static_assert(Quantize::posXError(-1599.99f) <= Quantize::POS_X_MAX_ERROR * 1.01f, "x error above half a step");
+static_assert(Quantize::posXError(1599.99f) <= Quantize::POS_X_MAX_ERROR * 1.01f, "x error above half a step");
+static_assert(Quantize::posYError(0.f) <= Quantize::POS_Y_MAX_ERROR * 1.01f, "y error above half a step");
+static_assert(Quantize::posYError(450.123f) <= Quantize::POS_Y_MAX_ERROR * 1.01f, "y error above half a step");
+static_assert(Quantize::posYError(-899.99f) <= Quantize::POS_Y_MAX_ERROR * 1.01f, "y error above half a step");
+static_assert(Quantize::rotationError(3.3f, 3.3f) <= Quantize::ROTATION_MAX_ERROR * 1.01f, "rotation error above half a step");
+static_assert(Quantize::rotationError(359.999f, 359.999f) <= Quantize::ROTATION_MAX_ERROR * 1.01f || Quantize::rotation(359.999f) == 0, "rotation error above half a step");
+static_assert(Quantize::rotationError(-45.5f, 314.5f) <= Quantize::ROTATION_MAX_ERROR * 1.01f, "rotation error above half a step");
+static_assert(Quantize::rotationError(725.f, 5.f) <= Quantize::ROTATION_MAX_ERROR * 1.01f, "rotation error above half a step");
+
+// exact and clamped values
+static_assert(Quantize::posX(Quantize::posX(Quantize::POS_X_MIN)) == Quantize::POS_X_MIN, "x min must be exact");
+static_assert(Quantize::posY(Quantize::posY(Quantize::POS_Y_MIN)) == Quantize::POS_Y_MIN, "y min must be exact");
+static_assert(Quantize::posX((float)Game::WINDOW_WIDTH * 4) == UINT16_MAX, "x is clamped to the world");
+static_assert(Quantize::posY(-(float)Game::WINDOW_HEIGHT * 4) == 0, "y is clamped to the world");
+static_assert(Quantize::rotation(360.f) == 0 && Quantize::rotation(-90.f) == Quantize::rotation(270.f), "rotation wraps");
+static_assert(Quantize::radius(Quantize::radius(37.f)) == 37.f, "whole radii are exact");
+static_assert(Quantize::radius(500.f) == Game::MAX_ASTEROID_RADIUS, "radius is clamped");
+
+#endif // __QUANTIZE_H__
@@ -0,0 +1,269 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file reliable.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the reliable delivery of server messages
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "reliable.h"
+
+ReliableSender& ReliableSender::getInstance() {
+	static ReliableSender instance;
+	return instance;
+}
+
+uint32_t ReliableSender::sendTo(std::vector<char> buf, SESSION_ID sid, const sockaddr_in& dest, OnComplete on_complete) {
+	Message msg;
+	msg.buf = std::move(buf);
+	msg.is_broadcast = false;
+	msg.dest = dest;
+	msg.on_complete = std::move(on_complete);
+
+	return queue(std::move(msg), { sid });
+}
+
+uint32_t ReliableSender::broadcast(std::vector<char> buf, const std::vector<SESSION_ID>& sids, OnComplete on_complete) {
+	Message msg;
+	msg.buf = std::move(buf);
+	msg.is_broadcast = true;
+	msg.on_complete = std::move(on_complete);
+
+	return queue(std::move(msg), sids);
+}
+
+uint32_t ReliableSender::queue(Message&& msg, const std::vector<SESSION_ID>& sids) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const uint32_t seq = next_seq++;
+
+	// seq in network byte order after cmd
+	if (msg.buf.size() < SEQ_OFFSET + sizeof(uint32_t)) {
+		msg.buf.resize(SEQ_OFFSET + sizeof(uint32_t));
+	}
+	msg.buf[SEQ_OFFSET + 0] = (seq >> 24) & 0xff;
+	msg.buf[SEQ_OFFSET + 1] = (seq >> 16) & 0xff;
+	msg.buf[SEQ_OFFSET + 2] = (seq >> 8) & 0xff;
+	msg.buf[SEQ_OFFSET + 3] = seq & 0xff;
+
+	msg.pending.insert(sids.begin(), sids.end());
+	for (SESSION_ID sid : sids) {
+		outstanding[sid].insert(seq);
+	}
+
+	msg.first_sent = Clock::now();
+	msg.attempts = 1;
+	transmit(msg);
+
+	Message& m = messages.emplace(seq, std::move(msg)).first->second;
+
+	if (m.pending.empty()) {
+		completed.push_back(seq);
+	}
+	else {
+		timers.push({ m.first_sent + retransmitTimeout(m), seq });
+	}
+	cv.notify_one();
+
+	return seq;
+}
+
+void ReliableSender::transmit(const Message& msg) {
+	int bytesSent = msg.is_broadcast
+		? Server::getInstance().broadcastData(msg.buf)
+		: Server::getInstance().sendData(msg.buf, msg.dest);
+
+	if (bytesSent < 0) {
+		std::lock_guard<std::mutex> stdoutlock(Server::getInstance()._stdoutMutex);
+		std::cerr << "reliable send failed" << std::endl;
+	}
+}
+
+ReliableSender::Clock::duration ReliableSender::retransmitTimeout(const Message& msg) {
+	double rto_ms = RttEstimator::MIN_RTO_MS;
+	for (SESSION_ID sid : msg.pending) {
+		rto_ms = std::max(rto_ms, rtt[sid].rto_ms);
+	}
+
+	// back off on every retransmission
+	for (int i = 1; i < msg.attempts && rto_ms < RttEstimator::MAX_RTO_MS; i++) {
+		rto_ms *= 2;
+	}
+	rto_ms = std::min(rto_ms, RttEstimator::MAX_RTO_MS);
+
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(rto_ms));
+}
+
+void ReliableSender::ack(SESSION_ID sid, uint32_t seq) {
+	const auto now = Clock::now();
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto sit = outstanding.find(sid);
+	if (sit == outstanding.end() || sit->second.erase(seq) == 0) {
+		// duplicate or stale ack
+		return;
+	}
+	if (sit->second.empty()) {
+		outstanding.erase(sit);
+	}
+
+	auto mit = messages.find(seq);
+	if (mit == messages.end()) {
+		return;
+	}
+
+	// a retransmitted message cannot tell which copy was acked
+	if (mit->second.attempts == 1) {
+		rtt[sid].sample(std::chrono::duration<double, std::milli>(now - mit->second.first_sent).count());
+	}
+
+	mit->second.pending.erase(sid);
+	if (mit->second.pending.empty()) {
+		completed.push_back(seq);
+		cv.notify_one();
+	}
+}
+
+void ReliableSender::removeSession(SESSION_ID sid) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	rtt.erase(sid);
+
+	auto sit = outstanding.find(sid);
+	if (sit == outstanding.end()) {
+		return;
+	}
+
+	for (uint32_t seq : sit->second) {
+		auto mit = messages.find(seq);
+		if (mit == messages.end()) {
+			continue;
+		}
+
+		mit->second.pending.erase(sid);
+		if (mit->second.pending.empty()) {
+			completed.push_back(seq);
+		}
+	}
+	outstanding.erase(sit);
+	cv.notify_one();
+}
+
+void ReliableSender::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (running) {
+		// release fully acked messages first
+		if (!completed.empty()) {
+			std::vector<OnComplete> callbacks;
+			for (uint32_t seq : completed) {
+				auto mit = messages.find(seq);
+				if (mit == messages.end()) {
+					continue;
+				}
+				if (mit->second.on_complete) {
+					callbacks.push_back(std::move(mit->second.on_complete));
+				}
+				messages.erase(mit);
+			}
+			completed.clear();
+
+			lock.unlock();
+			for (auto& cb : callbacks) {
+				cb({});
+			}
+			lock.lock();
+			continue;
+		}
+
+		if (timers.empty()) {
+			cv.wait(lock);
+			continue;
+		}
+
+		const Timer timer = timers.top();
+		const auto now = Clock::now();
+
+		if (timer.first > now) {
+			cv.wait_until(lock, timer.first);
+			continue;
+		}
+		timers.pop();
+
+		auto mit = messages.find(timer.second);
+		if (mit == messages.end()) {
+			// already acked
+			continue;
+		}
+		Message& msg = mit->second;
+
+		if (now - msg.first_sent >= std::chrono::milliseconds(Server::DISCONNECTION_TIMEOUT_DURATION_MS)) {
+			// give up, report sessions that never acked
+			std::vector<SESSION_ID> unacked(msg.pending.begin(), msg.pending.end());
+			for (SESSION_ID sid : unacked) {
+				auto sit = outstanding.find(sid);
+				if (sit == outstanding.end()) {
+					continue;
+				}
+				sit->second.erase(timer.second);
+				if (sit->second.empty()) {
+					outstanding.erase(sit);
+				}
+			}
+
+			OnComplete cb = std::move(msg.on_complete);
+			messages.erase(mit);
+
+			lock.unlock();
+			if (cb) {
+				cb(unacked);
+			}
+			lock.lock();
+			continue;
+		}
+
+		msg.attempts++;
+		for (SESSION_ID sid : msg.pending) {
+			rtt[sid].retransmits++;
+		}
+		transmit(msg);
+		timers.push({ now + retransmitTimeout(msg), timer.second });
+	}
+}
+
+void ReliableSender::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	cv.notify_one();
+}
+
+void ReliableSender::printStats(std::ostream& os) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	os << "reliable messages in flight: " << messages.size() << std::endl;
+
+	std::vector<SESSION_ID> sids;
+	for (const auto& [sid, est] : rtt) {
+		sids.push_back(sid);
+	}
+	std::sort(sids.begin(), sids.end());
+
+	for (SESSION_ID sid : sids) {
+		const RttEstimator& est = rtt[sid];
+		os << "session " << (int)sid << ": "
+			<< std::fixed << std::setprecision(1)
+			<< "srtt=" << est.srtt_ms << "ms rttvar=" << est.rttvar_ms << "ms rto=" << est.rto_ms << "ms"
+			<< std::defaultfloat
+			<< " (" << est.samples << " samples, " << est.retransmits << " retransmits)" << std::endl;
+	}
+}
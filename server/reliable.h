@@ -0,0 +1,176 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file reliable.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the reliable delivery of server messages
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __RELIABLE_H__
+#define __RELIABLE_H__
+
+#include "server.h"
+
+#include <functional>
+#include <ostream>
+#include <queue>
+
+/**
+ * smoothed round trip time of one session, rfc 6298.
+ * fed with ack timings of messages that were only sent once (karn's algorithm).
+ */
+struct RttEstimator {
+	static constexpr double ALPHA = 1.0 / 8;
+	static constexpr double BETA = 1.0 / 4;
+	static constexpr double K = 4;
+	static constexpr double G_MS = 1;				// clock granularity
+
+	static constexpr double MIN_RTO_MS = 20;
+	static constexpr double MAX_RTO_MS = 2000;
+
+	double srtt_ms{};
+	double rttvar_ms{};
+	double rto_ms = Server::TIMEOUT_MS;
+	uint64_t samples{};
+	uint64_t retransmits{};
+
+	void sample(double rtt_ms) {
+		if (samples++ == 0) {
+			srtt_ms = rtt_ms;
+			rttvar_ms = rtt_ms / 2;
+		}
+		else {
+			rttvar_ms = (1 - BETA) * rttvar_ms + BETA * std::abs(srtt_ms - rtt_ms);
+			srtt_ms = (1 - ALPHA) * srtt_ms + ALPHA * rtt_ms;
+		}
+
+		rto_ms = srtt_ms + std::max(G_MS, K * rttvar_ms);
+		rto_ms = std::min(std::max(rto_ms, MIN_RTO_MS), MAX_RTO_MS);
+	}
+};
+
+/**
+ * retransmits reliable server messages (CONN_ACCEPTED, START_GAME, END_GAME) until every
+ * session it was sent to has acked its sequence number.
+ *
+ * every reliable message carries its sequence number right after the cmd byte,
+ * clients ack with cmd, session id and the same sequence number.
+ * a single thread (run()) owns all retransmissions.
+ *
+ * a message is retransmitted after the largest rto of the sessions that have not acked it,
+ * doubled on every retransmission of that message.
+ */
+class ReliableSender {
+private:
+	ReliableSender() = default;
+
+public:
+	static ReliableSender& getInstance();
+
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * called once per message on the retransmit thread, when all sessions acked or the message timed out.
+	 * unacked holds the sessions that never acked, empty on success.
+	 */
+	using OnComplete = std::function<void(const std::vector<SESSION_ID>& unacked)>;
+
+	static constexpr int SEQ_OFFSET = 1;		// seq is written into buf[1..4]
+
+	/**
+	 * sends buf to a single session and retransmits until acked.
+	 *
+	 * \param buf message with room for the seq at SEQ_OFFSET
+	 * \param sid
+	 * \param dest
+	 * \param on_complete
+	 * \return seq of the message
+	 */
+	uint32_t sendTo(std::vector<char> buf, SESSION_ID sid, const sockaddr_in& dest, OnComplete on_complete = nullptr);
+
+	/**
+	 * broadcasts buf and rebroadcasts until every session in sids acked.
+	 *
+	 * \param buf message with room for the seq at SEQ_OFFSET
+	 * \param sids
+	 * \param on_complete
+	 * \return seq of the message
+	 */
+	uint32_t broadcast(std::vector<char> buf, const std::vector<SESSION_ID>& sids, OnComplete on_complete = nullptr);
+
+	void ack(SESSION_ID sid, uint32_t seq);
+
+	/**
+	 * stop waiting on acks from a disconnected session.
+	 *
+	 * \param sid
+	 */
+	void removeSession(SESSION_ID sid);
+
+	/**
+	 * retransmit loop. run on its own thread.
+	 *
+	 */
+	void run();
+
+	void stop();
+
+	/**
+	 * prints messages in flight and the rtt estimate of every session.
+	 * takes the sender lock, do not call while holding _stdoutMutex.
+	 *
+	 * \param os
+	 */
+	void printStats(std::ostream& os);
+
+private:
+	struct Message {
+		std::vector<char> buf;
+		bool is_broadcast{};
+		sockaddr_in dest{};
+
+		std::unordered_set<SESSION_ID> pending;		// sessions that have not acked
+		Clock::time_point first_sent;		// rtt samples are only taken while attempts == 1
+		int attempts{};
+
+		OnComplete on_complete;
+	};
+
+	uint32_t queue(Message&& msg, const std::vector<SESSION_ID>& sids);
+	void transmit(const Message& msg);
+
+	/**
+	 * time until the next retransmission of msg, with exponential backoff.
+	 *
+	 * \param msg
+	 * \return
+	 */
+	Clock::duration retransmitTimeout(const Message& msg);
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool running = true;
+
+	uint32_t next_seq = 1;
+
+	std::unordered_map<uint32_t, Message> messages;								// outstanding messages by seq
+	std::unordered_map<SESSION_ID, std::unordered_set<uint32_t>> outstanding;	// outstanding seqs per session
+	std::vector<uint32_t> completed;											// fully acked, waiting for on_complete
+	std::unordered_map<SESSION_ID, RttEstimator> rtt;
+
+	// retransmit deadlines. entries of already completed messages are skipped when popped
+	using Timer = std::pair<Clock::time_point, uint32_t>;
+	std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+};
+
+#endif // __RELIABLE_H__
@@ -20,6 +20,10 @@ prior written consent of DigiPen Institute of Technology is prohibited.
 
 #include "server.h"
 #include "game.h"
+#include "reliable.h"
+#include "snapshot.h"
+#include "pipeline.h"
+#include "buffer.h"
 
 //#define VERBOSE_LOGGING
 #define JS_DEBUG
@@ -77,13 +81,17 @@ Server& Server::getInstance() {
 //}
 
 int Server::sendData(const std::vector<char>& buffer, sockaddr_in udp_addr_in) {
+	return sendData(buffer.data(), (int)buffer.size(), udp_addr_in);
+}
+
+int Server::sendData(const char* buffer, int len, sockaddr_in udp_addr_in) {
 	if (udp_socket == INVALID_SOCKET) {
 		std::lock_guard<std::mutex> usersLock{ _stdoutMutex };
 		std::cerr << "Invalid socket." << std::endl;
 		return SOCKET_ERROR;
 	}
 
-	int bytesSent = sendto(udp_socket, buffer.data(), (int)buffer.size(), 0, reinterpret_cast<sockaddr*>(&udp_addr_in), sizeof(sockaddr_in));
+	int bytesSent = sendto(udp_socket, buffer, len, 0, reinterpret_cast<sockaddr*>(&udp_addr_in), sizeof(sockaddr_in));
 	if (bytesSent == SOCKET_ERROR) {
 		//std::lock_guard<std::mutex> usersLock{ _stdoutMutex };
 		char errorBuffer[256];
@@ -178,7 +186,8 @@ SOCKET Server::createUdpSocket(int port, bool broadcast) {
 		return INVALID_SOCKET;
 	}
 
-	if (broadcast && setsockopt(udpSocket, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char*>(&broadcast), sizeof(broadcast)) == SOCKET_ERROR)
+	const int enableBroadcast = 1;
+	if (broadcast && setsockopt(udpSocket, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char*>(&enableBroadcast), sizeof(enableBroadcast)) == SOCKET_ERROR)
 	{
 		std::cerr << "setsockopt() failed to enable broadcasting." << std::endl;
 		closesocket(udpSocket);
@@ -229,271 +238,283 @@ void Server::udpListener() {
 		return;
 	}
 
-	std::vector<char> recvbuffer;
-	recvbuffer.resize(MAX_PACKET_SIZE);
+	// preallocated receive buffers, one slot per datagram in a batch
+	std::vector<char> recvbuffers(RECV_BATCH_SIZE * MAX_PACKET_SIZE);
+	std::vector<sockaddr_in> senderAddrs(RECV_BATCH_SIZE);
 
-	while (udpListenerRunning) {
-		sockaddr_in senderAddr;
-		socklen_t senderAddrLen = sizeof(senderAddr);
+#ifdef __linux__
+	std::vector<mmsghdr> msgs(RECV_BATCH_SIZE);
+	std::vector<iovec> iovecs(RECV_BATCH_SIZE);
 
-		// Receive data from any client
-		int bytesReceived = recvfrom(udp_socket, recvbuffer.data(), (int)recvbuffer.size(), 0,
-			reinterpret_cast<sockaddr*>(&senderAddr), &senderAddrLen);
+	for (int i{}; i < RECV_BATCH_SIZE; i++) {
+		iovecs[i].iov_base = recvbuffers.data() + i * MAX_PACKET_SIZE;
+		iovecs[i].iov_len = MAX_PACKET_SIZE;
+	}
 
-		if (bytesReceived == -1 && WSAGetLastError() == WSAEWOULDBLOCK) {
-			// non blocking socket, no data to receive
+	while (udpListenerRunning) {
+		// block until the socket is readable
+		epoll_event ev{};
+		int num_events = epoll_wait(epoll_fd, &ev, 1, RECV_POLL_TIMEOUT_MS);
+		if (num_events <= 0) {
 			continue;
 		}
-		if (bytesReceived == -1 && WSAGetLastError() == WSAECONNRESET) {
-			// client crashed?
-		}
-		else if (bytesReceived == -1) {
-			std::lock_guard<std::mutex> usersLock{ _stdoutMutex };
-			char errorBuffer[256];
-			strerror_s(errorBuffer, sizeof(errorBuffer), errno);
-			std::cerr << "recvfrom() failed: " << errorBuffer << std::endl;
-
-			int wsaError = WSAGetLastError();
-			std::cerr << "recvfrom() failed with wsa error: " << wsaError << std::endl;
-		}
 
-		// acks
-		const int cmd = recvbuffer[0];
-		const int sid = recvbuffer[1];
-		bool isAck = false;
-
-		switch (cmd) {
-		case ACK_CONN_REQUEST: {
-			isAck = true;
-			{
-				std::lock_guard<std::mutex> acklock(ack_conn_request_clients_mutex);
-				ack_conn_request_clients.insert(sid);
-			}
-			{
-				std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
-				std::cout << "Client with SID " << sid << " acknowledged connection request." << std::endl;
+		// drain socket
+		while (true) {
+			for (int i{}; i < RECV_BATCH_SIZE; i++) {
+				SecureZeroMemory(&msgs[i], sizeof(mmsghdr));
+				msgs[i].msg_hdr.msg_name = &senderAddrs[i];
+				msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
 			}
-			break;
-		}
-		case ACK_START_GAME: {
-			isAck = true;
-			{
-				std::lock_guard<std::mutex> acklock(ack_start_game_clients_mutex);
-				ack_start_game_clients.insert(sid);
-			}
-			{
-				std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
-				std::cout << "Client with SID " << sid << " acknowledged start game." << std::endl;
-				std::cout << "Current ack count: " << ack_start_game_clients.size() << std::endl;
 
+			int num_msgs = recvmmsg(udp_socket, msgs.data(), RECV_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+			recv_syscalls++;
+
+			if (num_msgs == -1) {
+				if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED) {
+					std::lock_guard<std::mutex> usersLock{ _stdoutMutex };
+					std::cerr << "recvmmsg() failed: " << std::strerror(errno) << std::endl;
+				}
+				break;
 			}
-			break;
-		}
-		//case ACK_ALL_ENTITIES: {
-		//	isAck = true;
-		//	std::lock_guard<std::mutex> acklock(ack_all_entities_clients_mutex);
-		//	ack_all_entities_clients.insert(sid);
-		//	break;
-		//}
-		case ACK_END_GAME: {
-			isAck = true;
-			{
-				std::lock_guard<std::mutex> acklock(ack_end_game_clients_mutex);
-				ack_end_game_clients.insert(sid);
+
+			for (int i{}; i < num_msgs; i++) {
+				onDatagram(senderAddrs[i], recvbuffers.data() + i * MAX_PACKET_SIZE, (int)msgs[i].msg_len);
 			}
-			{
-				std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
-				std::cout << "Client with SID " << sid << " acknowledged end game." << std::endl;
+			notifyRequestHandler();
+
+			if (num_msgs < RECV_BATCH_SIZE) {
+				// socket drained
+				break;
 			}
-			break;
-		}
 		}
+	}
+#else
+	WSAPOLLFD pfd{};
+	pfd.fd = udp_socket;
+	pfd.events = POLLRDNORM;
 
-		if (isAck) {
-			// if is ack, dont push into recvbuffer_queue as already recorded in ack
+	while (udpListenerRunning) {
+		// block until the socket is readable
+		int num_events = WSAPoll(&pfd, 1, RECV_POLL_TIMEOUT_MS);
+		if (num_events <= 0) {
 			continue;
 		}
 
+		// drain socket
+		while (true) {
+			socklen_t senderAddrLen = sizeof(sockaddr_in);
+
+			int bytesReceived = recvfrom(udp_socket, recvbuffers.data(), MAX_PACKET_SIZE, 0,
+				reinterpret_cast<sockaddr*>(&senderAddrs[0]), &senderAddrLen);
+			recv_syscalls++;
+
+			if (bytesReceived == SOCKET_ERROR) {
+				int wsaError = WSAGetLastError();
+				if (wsaError == WSAECONNRESET) {
+					// client crashed?
+					continue;
+				}
+				if (wsaError != WSAEWOULDBLOCK) {
+					std::lock_guard<std::mutex> usersLock{ _stdoutMutex };
+					std::cerr << "recvfrom() failed with wsa error: " << wsaError << std::endl;
+				}
+				break;
+			}
+
+			onDatagram(senderAddrs[0], recvbuffers.data(), bytesReceived);
+		}
+		notifyRequestHandler();
+	}
+#endif
+}
+
+void Server::notifyRequestHandler() {
+	if (recvbuffer_queue.size() == 0) {
+		return;
+	}
+
+	// lock so the wakeup cannot land between requestHandler checking the queue and waiting
+	{
+		std::lock_guard<std::mutex> lock(recv_mutex);
+	}
+	recv_cv.notify_one();
+}
+
+void Server::onDatagram(const sockaddr_in& senderAddr, const char* buf, int len) {
+	if (len < 1) {
+		return;
+	}
+	recv_packets++;
+
+	// acks, cmd - session id - seq number
+	BufferReader reader(buf, len);
+	const int cmd = (char)reader.u8();
+	const int sid = len > 1 ? (char)reader.u8() : -1;
+	const uint32_t seq = reader.u32();
+	bool isAck = false;
+
+	switch (cmd) {
+	case ACK_CONN_REQUEST: {
+		isAck = true;
+		ReliableSender::getInstance().ack(sid, seq);
 		{
-			std::lock_guard<std::mutex> lock(recvbuffer_queue_mutex);
-			recvbuffer_queue.push_back({ senderAddr, recvbuffer });
+			std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
+			std::cout << "Client with SID " << sid << " acknowledged connection request." << std::endl;
 		}
+		break;
 	}
+	case ACK_START_GAME: {
+		isAck = true;
+		ReliableSender::getInstance().ack(sid, seq);
+		{
+			std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
+			std::cout << "Client with SID " << sid << " acknowledged start game." << std::endl;
+		}
+		break;
+	}
+	case ACK_ALL_ENTITIES: {
+		isAck = true;
+		SnapshotEncoder::getInstance().ack(sid, seq);
+		break;
+	}
+	case ACK_END_GAME: {
+		isAck = true;
+		ReliableSender::getInstance().ack(sid, seq);
+		{
+			std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
+			std::cout << "Client with SID " << sid << " acknowledged end game." << std::endl;
+		}
+		break;
+	}
+	}
+
+	if (isAck) {
+		// if is ack, dont push into recvbuffer_queue as already recorded in ack
+		return;
+	}
+
+	recvbuffer_queue.push(senderAddr, buf, len);
 }
 
 
 void Server::requestHandler() {
 
-	while (udpListenerRunning) {
-		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	static constexpr auto TICK_DURATION = std::chrono::microseconds(1000000 / TICK_RATE);
 
-		// get data
-		std::deque<std::pair<sockaddr_in, std::vector<char>>> recvbuffer;
+	while (udpListenerRunning) {
+		// wait for packets, at most one tick
 		{
-			std::lock_guard<std::mutex> lock(recvbuffer_queue_mutex);
-
-			recvbuffer = recvbuffer_queue;
-			recvbuffer_queue.clear();
+			std::unique_lock<std::mutex> lock(recv_mutex);
+			recv_cv.wait_for(lock, TICK_DURATION, [this]() { return recvbuffer_queue.size() > 0 || !udpListenerRunning; });
 		}
 
 		//static std::vector<char> sbuf(MAX_PACKET_SIZE);
 		//if (sbuf.size() != MAX_PACKET_SIZE)
 		//	sbuf.resize(MAX_PACKET_SIZE);
 
-		// handle data
-		for (const auto [senderAddr, rbuf] : recvbuffer) {
+		// handle data in place, slot is released after the packet is handled
+		for (RecvQueue::Packet* pkt = recvbuffer_queue.front(); pkt != nullptr; recvbuffer_queue.pop(), pkt = recvbuffer_queue.front()) {
+			const sockaddr_in senderAddr = pkt->addr;
+			const char* rbuf = pkt->data;
 			const int cmd = rbuf[0];
 
+			// every handler reads the payload after the cmd byte
+			BufferReader reader(rbuf, pkt->len);
+			reader.u8();
+
+			request_queue_delay.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pkt->recv_time).count());
+
 			switch (cmd) {
 			case CONN_REQUEST: {
 				//std::cout << "Connection Requested By Client" << std::endl;
-				static std::vector<char> sbuf(16);
 
-				int num_players{};
-				{
-					std::lock_guard<std::mutex> spaceshipsdatalock(Game::getInstance().data_mutex);
-					num_players = (int)Game::getInstance().data.spaceships.size();
-				}
+				const int num_players = (int)Game::getInstance().published()->players.size();
 
-				if (num_players >= Game::MAX_PLAYERS || Game::getInstance().gameRunning) {
+				// only join in the lobby
+				if (num_players >= Game::MAX_PLAYERS || Game::getInstance().matchState() != Game::MatchState::LOBBY) {
 					{
 						std::lock_guard<std::mutex> coutlock(_stdoutMutex);
 						std::cout << "Connection refused. " << (num_players >= Game::MAX_PLAYERS ? "Too many players." : "Game is running") << std::endl;
 					}
 
-					sbuf[0] = CONN_REJECTED;
-					sendData(sbuf, senderAddr);
+					// same 20 bytes as CONN_ACCEPTED, only the cmd is read
+					char reject[20]{ CONN_REJECTED };
+					sendData(reject, (int)sizeof(reject), senderAddr);
+					break;
+				}
+
+				// get player name
+				const uint8_t name_length = reader.u8();
+				const char* name_bytes = reader.bytes(name_length);
+				if (!reader.ok()) {
 					break;
 				}
+				std::string name(name_bytes, name_length);
 
 				// player allowed
 				const int sid = getSessionId();
 
 				// create new player spaceship
-				Game::Spaceship new_spaceship{};
-				new_spaceship.pos = { 0, 0 };
-				new_spaceship.vector = { 0, 0 };
-				new_spaceship.radius = Game::SPACESHIP_RADIUS;
-				new_spaceship.sid = sid;
-				new_spaceship.rotation = 0.f;
-				new_spaceship.lives_left = Game::NUM_START_LIVES;
-				new_spaceship.score = 0;
-				// get player name
-				for (char i{}; i < rbuf[1]; i++) {
-					new_spaceship.name += rbuf[2 + i];
-				}
 				{
 					std::lock_guard<std::mutex> spaceshipsdatalock(Game::getInstance().data_mutex);
-					Game::getInstance().data.spaceships.push_back(new_spaceship);
+					Game::Data& data = Game::getInstance().data;
+					data.spaceships.add(data.ids.allocate(), sid, std::move(name));
+					Game::getInstance().publish();
 				}
 
-				int buf_idx{};
+				// kept by ReliableSender for retransmission
+				std::vector<char> sbuf(20);
+				BufferWriter writer(sbuf.data(), sbuf.size());
+
+				writer.u8(CONN_ACCEPTED);
 
-				sbuf[buf_idx++] = CONN_ACCEPTED;
+				// seq number, filled in by ReliableSender
+				writer.u32(0);
 
 				// session id
-				sbuf[buf_idx++] = sid;
+				writer.u8((uint8_t)sid);
 
 				// broadcast port
-				sbuf[buf_idx++] = (serverUdpPortBroadcast >> 8) & 0xff;
-				sbuf[buf_idx++] = serverUdpPortBroadcast & 0xff;
+				writer.u16((uint16_t)serverUdpPortBroadcast);
 
 				// spawn locations (world pos)
 				constexpr float spawnX = 500.f;
 				constexpr float spawnY = 500.f;
 
-				memcpy(sbuf.data() + buf_idx, t_to_bytes(spawnX).data(), sizeof(float));
-				buf_idx += (int)sizeof(float);
-				memcpy(sbuf.data() + buf_idx, t_to_bytes(spawnY).data(), sizeof(float));
-				buf_idx += (int)sizeof(float);
+				writer.f32(spawnX);
+				writer.f32(spawnY);
 
 				// spawn rotation
 				constexpr float rotation_deg = 15.1f;
 
-				memcpy(sbuf.data() + buf_idx, t_to_bytes(rotation_deg).data(), sizeof(float));
-				buf_idx += (int)sizeof(float);
+				writer.f32(rotation_deg);
 
 				//// num lives
-				//sbuf[buf_idx++] = Game::NUM_START_LIVES;
+				//writer.u8(Game::NUM_START_LIVES);
 
-				auto reliableSender = [&]() {
-					float elapsedMs{};
-					auto start = std::chrono::high_resolution_clock::now();
-					char senderIP[INET_ADDRSTRLEN];
-					inet_ntop(AF_INET, &(senderAddr.sin_addr), senderIP, INET_ADDRSTRLEN);
-#ifdef VERBOSE_LOGGING
-					{
-						std::lock_guard<std::mutex> coutlock(_stdoutMutex);
-						std::cout << "Received data from " << senderIP << ":" << ntohs(senderAddr.sin_port) << std::endl;
+				ReliableSender::getInstance().sendTo(std::move(sbuf), sid, senderAddr, [this, sid](const std::vector<SESSION_ID>& unacked) {
+					if (unacked.empty()) {
+						std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
+						std::cout << "Connection accepted. Sent data to client. Client ACKed SID: " << sid << std::endl;
+						return;
 					}
-#endif
-
-					while (true) {
-						// Send data
-						int bytesSent = sendData(sbuf, senderAddr);
-						if (bytesSent < 0) {
-							std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
-							std::cerr << "sendData() failed: " << "\n";
-						}
-#ifdef VERBOSE_LOGGING
-						{
-							// Debug: Print packet contents before sending
-							std::stringstream ss;
-							ss << "Sending packet: ";
-							for (int i = 0; i < sbuf.size(); ++i) {
-								ss << std::hex << std::setw(2) << std::setfill('0') << (int)(uint8_t)sbuf[i] << " ";
-							}
-							ss << std::dec << "\n";
-
-							else {
-								ss << "Sent " << bytesSent << " bytes to " << senderIP << ":" << ntohs(senderAddr.sin_port) << "\n";
-							}
-
-							{
-								std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
-								std::cout << ss.str() << std::endl;
-							}
-						}
-#endif
-
 
-						{
-							std::lock_guard<std::mutex> conn_req_lock(ack_conn_request_clients_mutex);
-							if (ack_conn_request_clients.find(sid) != ack_conn_request_clients.end()) {
-								// client has acked.
-								ack_conn_request_clients.erase(sid);
-								break;
-							}
-						}
-						std::this_thread::sleep_for(std::chrono::milliseconds(TIMEOUT_MS));
-
-						elapsedMs = static_cast<float>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count());
-						if (elapsedMs >= DISCONNECTION_TIMEOUT_DURATION_MS) {
-							// disconnect client
-							{
-								std::lock_guard<std::mutex> spaceshipsdatalock(Game::getInstance().data_mutex);
-								auto it = std::find_if(Game::getInstance().data.spaceships.begin(), Game::getInstance().data.spaceships.end(), [sid](const Game::Spaceship& s) { return s.sid == sid; });
-								if (it != Game::getInstance().data.spaceships.end())
-									Game::getInstance().data.spaceships.erase(it);
-							}
-							{
-								std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
-								std::cout << "Client timed out(disconnected): " << sid << std::endl;
-							}
-							return;
-						}
+					// disconnect client
+					{
+						std::lock_guard<std::mutex> spaceshipsdatalock(Game::getInstance().data_mutex);
+						Game::getInstance().data.removeSpaceship(sid);
+						Game::getInstance().publish();
 					}
+					ReliableSender::getInstance().removeSession(sid);
+					SnapshotEncoder::getInstance().removeSession(sid);
 					{
 						std::lock_guard<std::mutex> stdoutlock(_stdoutMutex);
-						std::cout << "Connection accepted. Sent data to client. Client ACKed SID: " << sid << std::endl;
+						std::cout << "Client timed out(disconnected): " << sid << std::endl;
 					}
-					};
-				//std::thread t(reliableSender);
-				{
-					std::lock_guard<std::mutex> tplock(threadpool_mutex);
-					threadpool.push_back(std::async(std::launch::async, reliableSender));
-				}
-
+				});
 
 				break;
 			}
@@ -501,213 +522,123 @@ void Server::requestHandler() {
 
 				std::cout << "Received start game request." << std::endl;
 
-				if (Game::getInstance().gameRunning) {
+				// ignore start requests while a match is starting, running or ending
+				if (!Game::getInstance().transition(Game::MatchState::LOBBY, Game::MatchState::STARTING)) {
 					break;
 				}
 
-				std::vector<char> buf;
-				buf.reserve(100);
-				//buf.resize(MAX_PACKET_SIZE);
-
-				buf.push_back(START_GAME);
-				
-				{
-					std::lock_guard<std::mutex> dlock(Game::getInstance().data_mutex);
+				// players only join in the lobby, which was just left
+				const std::shared_ptr<const Game::Published> state = Game::getInstance().published();
 
-					// num players
-					buf.push_back((char)Game::getInstance().data.spaceships.size());
-
-					for (const Game::Spaceship& s : Game::getInstance().data.spaceships) {
-						buf.push_back(s.sid & 0xff);			// sid
-						buf.push_back((char)s.name.size());		// playername size
-						for (const char c : s.name) {			// player name
-							buf.push_back(c);
-						}
-					}
+				// kept by ReliableSender for retransmission, sized once
+				size_t size = 1 + sizeof(uint32_t) + 1;
+				for (const Game::Published::Player& player : state->players) {
+					size += 2 + player.name.size();
 				}
+				std::vector<char> buf(size);
+				BufferWriter writer(buf.data(), buf.size());
 
-				Game::getInstance().data.reset();
+				writer.u8(START_GAME);
 
-				int num_conns;
-				{
-					std::lock_guard<std::mutex> lock(Game::getInstance().data_mutex);
-					num_conns = (int)Game::getInstance().data.spaceships.size();
-				}
+				// seq number, filled in by ReliableSender
+				writer.u32(0);
 
-				auto bc = [this, buf, num_conns]() {  
+				// num players
+				writer.u8((uint8_t)state->players.size());
 
-					int num_acks = 0;
-
-					auto start = std::chrono::high_resolution_clock::now();
-
-					// wait for all clients to ack
-					while (num_acks < num_conns) {
-						{
-							std::lock_guard<std::mutex> coutlock(_stdoutMutex);
-							std::cout << "Sending START_GAME " << buf.size() << " bytes" << std::endl;
-						}
+				std::vector<SESSION_ID> sids;
+				for (const Game::Published::Player& player : state->players) {
+					writer.u8((uint8_t)player.sid);						// sid
+					writer.u8((uint8_t)player.name.size());				// playername size
+					writer.bytes(player.name.data(), player.name.size());	// player name
+					sids.push_back(player.sid);
+				}
 
-						auto curr = std::chrono::high_resolution_clock::now();
-
-						if (curr - start >= std::chrono::milliseconds(DISCONNECTION_TIMEOUT_DURATION_MS)) {
-							// disconnect clients that did not ack
-							std::unordered_set<SESSION_ID> acked_clients;
-							{
-								std::lock_guard<std::mutex> req_start_game_ack_lock(ack_start_game_clients_mutex);
-								acked_clients = ack_start_game_clients;
-							}
-
-
-							{
-								std::unordered_set<SESSION_ID> timeout_disconnect_clients;
-								std::lock_guard<std::mutex> clientslock(Game::getInstance().data_mutex);
-
-								// remove sessions that timed out
-								for (auto it = Game::getInstance().data.spaceships.begin(); it != Game::getInstance().data.spaceships.end();) {
-									if (acked_clients.find(it->sid) != acked_clients.end()) {
-										++it;
-										continue;
-									}
-									it = Game::getInstance().data.spaceships.erase(it);
-								}
-								// num_conns = (int)Game::getInstance().data.spaceships.size();
-							}
-
-							break;
-						}
+				{
+					std::lock_guard<std::mutex> coutlock(_stdoutMutex);
+					std::cout << "Sending START_GAME " << buf.size() << " bytes" << std::endl;
+				}
 
+				// broadcast game start through reliable udp communication. the retransmit thread finishes the
+				// handshake once the last client acked or timed out, requests keep being handled meanwhile
+				ReliableSender::getInstance().broadcast(std::move(buf), sids, [](const std::vector<SESSION_ID>& unacked) {
+					Game& game = Game::getInstance();
 
-						// Check the number of acks
-						{
-							std::lock_guard<std::mutex> acklock(ack_start_game_clients_mutex);
-							num_acks = (int)ack_start_game_clients.size();
-						}
+					bool any_player{};
+					{
+						std::lock_guard<std::mutex> dlock(game.data_mutex);
 
-						if (num_acks >= num_conns) {
-							Game::getInstance().data.reset();
-							Game::getInstance().gameRunning = true;
-							break;
+						// disconnect clients that did not ack, the rest start without them
+						for (SESSION_ID sid : unacked) {
+							game.data.removeSpaceship(sid);
 						}
-
-						// Continue broadcasting to request acks
-						broadcastData(buf);
-						std::this_thread::sleep_for(std::chrono::milliseconds(TIMEOUT_MS));
-
-					}
-
-					// cleanup acks
-					{
-						std::lock_guard<std::mutex> req_start_game_ack_lock(ack_start_game_clients_mutex);
-						ack_start_game_clients.clear();
+						game.data.reset();
+						game.publish();
+						any_player = !game.data.spaceships.empty();
 					}
-				};
 
-				// broadcast game start through reliable udp communication
-				bc();
+					// wakes up the game thread
+					game.transition(Game::MatchState::STARTING, any_player ? Game::MatchState::RUNNING : Game::MatchState::LOBBY);
+				});
 
 				break;
 			}
 			case SELF_SPACESHIP: {
 				//std::cout << "Received self spaceship." << std::endl;
 
-				std::vector<char> sbuf;
-
-				// locking for this entire block to prevent overwriting from gameUpdate
-				std::lock_guard<std::mutex> lock(Game::getInstance().data_mutex);
-
-				const SESSION_ID sid = rbuf[1];
-
-				int idx = 2;
-
-				auto spaceship = std::find_if(
-					Game::getInstance().data.spaceships.begin(),
-					Game::getInstance().data.spaceships.end(),
-					[&sid](const Game::Spaceship& s) { return s.sid == sid; }
-				);
-
-				if (spaceship == Game::getInstance().data.spaceships.end()) {
-					
-					return;
+				// only the game thread touches the spaceships, it applies the input at the start of the next tick
+				if (Game::getInstance().matchState() != Game::MatchState::RUNNING) {
+					break;
 				}
 
-				// vector x
-				std::vector<char> bytes(rbuf.begin() + idx, rbuf.begin() + idx + sizeof(float));
-				spaceship->vector.x = btof(bytes);
-				idx += (int)sizeof(float);
+				Game::Input input;
+				input.type = Game::Input::Type::SPACESHIP;
+				input.sid = reader.i8();
+				input.seq = reader.u32();
+				input.vector.x = reader.f32();
+				input.vector.y = reader.f32();
+				input.rotation = reader.f32();
 
-				// vector y
-				bytes.assign(rbuf.begin() + idx, rbuf.begin() + idx + sizeof(float));
-				spaceship->vector.y = btof(bytes);
-				idx += (int)sizeof(float);
-
-				// rotation
-				bytes.assign(rbuf.begin() + idx, rbuf.begin() + idx + sizeof(float));
-				spaceship->rotation = btof(bytes);
-				idx += (int)sizeof(float);
+				// truncated packet
+				if (!reader.ok()) {
+					break;
+				}
 
+				Game::getInstance().pushInput(input);
 				break;
 			}
 			case NEW_BULLET: {
-				// send ack first
-				std::vector<char> sbuf;
-				sbuf.push_back(ACK_NEW_BULLET);
-				sbuf.push_back(rbuf[2]);
-				sbuf.push_back(rbuf[3]);
-				sbuf.push_back(rbuf[4]);
-				sbuf.push_back(rbuf[5]);
-				sendData(sbuf, senderAddr);
-
-				int sid = rbuf[1];
-				int bid = rbuf[2] << 24 | rbuf[3] << 16 | rbuf[4] << 8 | rbuf[5];
-				int idx = 6;
-
-				{
-					std::lock_guard<std::mutex> dlock(Game::getInstance().data_mutex);
-					if (std::find_if(Game::getInstance().data.bullets.begin(), Game::getInstance().data.bullets.end(),
-						[bid](const Game::Bullet& b) {
-							return b.bullet_id == bid;
-						}
-					) != Game::getInstance().data.bullets.end()) {
-						// bullet has already been registered, ignore.
-						break;
-					}
-				}
-
-				{
-					std::lock_guard<std::mutex> coutlock(_stdoutMutex);
-					std::cout << "Registering new bullet " << bid << std::endl;
+				Game::Input input;
+				input.type = Game::Input::Type::BULLET;
+				input.sid = reader.i8();
+				input.bullet_id = (int)reader.u32();
+				input.pos.x = reader.f32();
+				input.pos.y = reader.f32();
+				input.vector.x = reader.f32();
+				input.vector.y = reader.f32();
+
+				// truncated packet, the client resends it
+				if (!reader.ok()) {
+					break;
 				}
 
-				Game::Bullet nb{};
-
-				// pos x
-				std::vector<char> bytes(rbuf.begin() + idx, rbuf.begin() + idx + sizeof(float));
-				nb.pos.x = btof(bytes);
-				idx += (int)sizeof(float);
-
-				// pos y
-				bytes.assign(rbuf.begin() + idx, rbuf.begin() + idx + sizeof(float));
-				nb.pos.y = btof(bytes);
-				idx += (int)sizeof(float);
-
-				// vector x
-				bytes.assign(rbuf.begin() + idx, rbuf.begin() + idx + sizeof(float));
-				nb.vector.x = btof(bytes);
-				idx += (int)sizeof(float);
-
-				// vector y
-				bytes.assign(rbuf.begin() + idx, rbuf.begin() + idx + sizeof(float));
-				nb.vector.y = btof(bytes);
-				idx += (int)sizeof(float);
+				// send ack first
+				char ack[5];
+				BufferWriter writer(ack);
+				writer.u8(ACK_NEW_BULLET);
+				writer.u32((uint32_t)input.bullet_id);
+				sendData(ack, (int)writer.size(), senderAddr);
 
-				{
-					std::lock_guard<std::mutex> dlock(Game::getInstance().data_mutex);
-					Game::getInstance().data.bullets.push_back(nb);
+				if (Game::getInstance().matchState() != Game::MatchState::RUNNING) {
+					break;
 				}
+
+				// duplicates are filtered when the game thread applies it
+				Game::getInstance().pushInput(input);
 				break;
 			}
 			case KEEP_ALIVE: {
-				int sid = rbuf[1];
+				int sid = reader.i8();
 
 				std::lock_guard<std::mutex> alivelock(keep_alive_mutex);
 				keep_alive_map[sid] = std::chrono::high_resolution_clock::now();
@@ -828,6 +759,25 @@ int Server::init() {
 	u_long mode = 1;
 	ioctlsocket(udp_socket, FIONBIO, &mode);
 
+#ifdef __linux__
+	// udpListener waits on epoll instead of spinning on the non-blocking socket
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd == -1) {
+		std::lock_guard<std::mutex> usersLock{ _stdoutMutex };
+		std::cerr << "epoll_create1() failed: " << std::strerror(errno) << std::endl;
+		return 6;
+	}
+
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.fd = udp_socket;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, udp_socket, &ev) == -1) {
+		std::lock_guard<std::mutex> usersLock{ _stdoutMutex };
+		std::cerr << "epoll_ctl() failed: " << std::strerror(errno) << std::endl;
+		return 6;
+	}
+#endif
+
 	return 0;
 }
 
@@ -838,6 +788,38 @@ void Server::cleanup() {
 		std::lock_guard<std::mutex> udpInfoLock(udp_info_mutex);
 		freeaddrinfo(udp_info);
 	}
+
+#ifdef __linux__
+	if (epoll_fd != -1) {
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+#endif
+}
+
+
+void Server::printStats() {
+	const uint64_t syscalls = recv_syscalls;
+	const uint64_t packets = recv_packets;
+
+	// collected before taking _stdoutMutex, ReliableSender logs while holding its own lock
+	std::ostringstream reliable_stats;
+	ReliableSender::getInstance().printStats(reliable_stats);
+
+	std::lock_guard<std::mutex> coutlock(_stdoutMutex);
+	std::cout << "recv: " << packets << " packets, " << syscalls << " syscalls";
+	if (packets) {
+		std::cout << " (" << std::fixed << std::setprecision(2) << (double)syscalls / packets << " syscalls/packet)" << std::defaultfloat;
+	}
+	std::cout << std::endl;
+	std::cout << "recv queue: " << recvbuffer_queue.size() << "/" << MAX_PACKET_QUEUE << " queued, "
+		<< recvbuffer_queue.dropped() << " dropped (queue full), "
+		<< recvbuffer_queue.truncated() << " truncated" << std::endl;
+	request_queue_delay.print(std::cout, "request queue delay");
+	Game::getInstance().printStats(std::cout);
+	SnapshotEncoder::getInstance().printStats(std::cout);
+	SnapshotPipeline::getInstance().printStats(std::cout);
+	std::cout << reliable_stats.str();
 }
 
 
@@ -857,15 +839,14 @@ void Server::keepAliveChecker() {
 					// remove spaceship from game, client timed out
 					{
 						std::lock_guard<std::mutex> gdlock(Game::getInstance().data_mutex);
-						for (auto it = Game::getInstance().data.spaceships.begin(); it != Game::getInstance().data.spaceships.end();) {
-							if (it->sid == sid) {
-								it = Game::getInstance().data.spaceships.erase(it);
-								break;
-							}
-							++it;
-						}
+						Game::getInstance().data.removeSpaceship(sid);
+						Game::getInstance().publish();
 					}
 
+					// stop waiting on its acks
+					ReliableSender::getInstance().removeSession(sid);
+					SnapshotEncoder::getInstance().removeSession(sid);
+
 					{
 						std::lock_guard<std::mutex> coutlock(_stdoutMutex);
 						std::cout << "Client " << sid << " timed out" << std::endl;
@@ -883,30 +864,6 @@ void Server::keepAliveChecker() {
 	}
 }
 
-/* thread management */
-
-std::deque<std::future<void>> Server::threadpool;
-std::mutex Server::threadpool_mutex;
-
-void Server::threadpoolManager() {
-	while (Server::getInstance().udpListenerRunning) {
-		std::vector<std::future<void>> pool;
-		{
-			std::lock_guard<std::mutex> lock(threadpool_mutex);
-			pool.insert(pool.end(), std::make_move_iterator(threadpool.begin()), std::make_move_iterator(threadpool.end()));
-			threadpool.clear();
-		}
-
-
-		for (auto& fut : pool) {
-			fut.get();	// waits till thread has completed
-		}
-
-		// at this point, all threads have completed
-	}
-}
-
-
 std::string Server::getCurrentDateString() {
 	auto now = std::chrono::system_clock::now();
 	std::time_t now_c = std::chrono::system_clock::to_time_t(now);
@@ -19,6 +19,8 @@ prior written consent of DigiPen Institute of Technology is prohibited.
 #ifndef __SERVER_H__
 #define __SERVER_H__
 
+#ifdef _WIN32
+
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN		// REQUIRED!! OR DUPLICATE DEFINITION
 #endif
@@ -32,6 +34,51 @@ prior written consent of DigiPen Institute of Technology is prohibited.
 // but including it in the source code simplifies the configuration.
 #pragma comment(lib, "ws2_32.lib")
 
+#else
+
+// linux socket backend. maps the few winsock names used by the server onto posix
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+using SOCKET = int;
+using u_long = unsigned long;
+struct WSADATA {};
+
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+constexpr int NO_ERROR = 0;
+constexpr int WSAEWOULDBLOCK = EWOULDBLOCK;
+constexpr int WSAECONNRESET = ECONNRESET;
+
+#define MAKEWORD(a, b) ((a) | ((b) << 8))
+#define SecureZeroMemory(ptr, size) std::memset((ptr), 0, (size))
+
+inline int WSAStartup(int, WSADATA*) { return 0; }
+inline int WSACleanup() { return 0; }
+inline int WSAGetLastError() { return errno; }
+inline int closesocket(SOCKET s) { return close(s); }
+inline int ioctlsocket(SOCKET s, unsigned long cmd, u_long* arg) { return ioctl(s, cmd, arg); }
+
+inline int strerror_s(char* buf, size_t size, int err) {
+	std::strncpy(buf, std::strerror(err), size - 1);
+	buf[size - 1] = '\0';
+	return 0;
+}
+
+inline int localtime_s(std::tm* tm, const std::time_t* time) {
+	return localtime_r(time, tm) ? 0 : errno;
+}
+
+#endif
+
 #include <iostream>			// cout, cerr
 #include <string>			// string
 #include <unordered_map>
@@ -48,7 +95,14 @@ prior written consent of DigiPen Institute of Technology is prohibited.
 #include <mutex>
 #include <deque>
 #include <bitset>
-#include <future>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+
+#include <condition_variable>
+
+#include "packetqueue.h"
+#include "stats.h"
 
 using SESSION_ID = int;
 
@@ -60,6 +114,7 @@ public:
 	static Server& getInstance();
 
 	static constexpr int TICK_RATE = 120;
+	static constexpr int SNAPSHOT_RATE = 30;		// ALL_ENTITIES per second, clients interpolate between them
 
 	static constexpr int MAX_PACKET_SIZE = 1000;
 
@@ -86,30 +141,37 @@ public:
 
 	bool udpListenerRunning = true;
 
-	// ack stuff
-	std::unordered_set<SESSION_ID> ack_conn_request_clients;
-	std::mutex ack_conn_request_clients_mutex;
-
-	std::unordered_set<SESSION_ID> ack_start_game_clients;
-	std::mutex ack_start_game_clients_mutex;
-
-	//std::unordered_set<SESSION_ID> ack_all_entities_clients;
-	//std::mutex ack_all_entities_clients_mutex;
+	// batched receive. udpListener blocks for at most RECV_POLL_TIMEOUT_MS so that
+	// udpListenerRunning is still checked, then drains the socket RECV_BATCH_SIZE datagrams at a time
+	static constexpr int RECV_BATCH_SIZE = 32;
+	static constexpr int RECV_POLL_TIMEOUT_MS = 100;
+#ifdef __linux__
+	int epoll_fd = -1;
+#endif
 
-	std::unordered_set<SESSION_ID> ack_end_game_clients;
-	std::mutex ack_end_game_clients_mutex;
+	std::atomic<uint64_t> recv_syscalls{};
+	std::atomic<uint64_t> recv_packets{};
 
 	std::unordered_map<SESSION_ID, float> client_last_request_time;		// used to timeout client connection
 	std::mutex client_last_request_time_mutex;
 
 	// timeout stuff
 	static constexpr int DISCONNECTION_TIMEOUT_DURATION_MS = 15000;
-	static constexpr int TIMEOUT_MS = 200;		// timeout before retrying
+	static constexpr int TIMEOUT_MS = 200;		// retransmission timeout of a session before its first rtt sample
 
 	// recv stuff
+	// udpListener -> requestHandler. drops newest packet when MAX_PACKET_QUEUE packets are pending
 	static constexpr int MAX_PACKET_QUEUE = 100;
-	std::deque<std::pair<sockaddr_in, std::vector<char>>> recvbuffer_queue;
-	std::mutex recvbuffer_queue_mutex;
+	using RecvQueue = PacketQueue<sockaddr_in, MAX_PACKET_SIZE, MAX_PACKET_QUEUE>;
+	RecvQueue recvbuffer_queue;
+
+	// requestHandler sleeps on recv_cv until packets are queued or a tick has passed
+	std::mutex recv_mutex;
+	std::condition_variable recv_cv;
+	void notifyRequestHandler();
+
+	// time between a packet being queued and requestHandler picking it up
+	LatencyHistogram request_queue_delay;
 
 
 	enum CLIENT_REQUESTS {
@@ -120,7 +182,8 @@ public:
 		SELF_SPACESHIP,
 		NEW_BULLET,
 		ACK_END_GAME,
-		KEEP_ALIVE
+		KEEP_ALIVE,
+		ACK_ALL_ENTITIES
 	};
 
 	enum SERVER_MSGS {
@@ -144,40 +207,6 @@ public:
 	std::unordered_map<SOCKET, Client> conns;
 	std::mutex conns_mutex;
 
-	template <typename T>
-	static std::vector<char> t_to_bytes(T num) {
-		std::vector<char> bytes(sizeof(T));
-
-		if constexpr (std::is_integral<T>::value) {
-			// for ints, convert to network byte order
-			num = htonl(num);
-			std::memcpy(bytes.data(), &num, sizeof(T));
-		}
-		else if constexpr (std::is_floating_point<T>::value) {
-			// For floats
-			unsigned int int_rep = *reinterpret_cast<unsigned int*>(&num);  // reinterpret float as unsigned int
-			int_rep = htonl(int_rep);
-			std::memcpy(bytes.data(), &int_rep, sizeof(T));
-		}
-
-		return bytes;
-	}
-
-	static float btof(const std::vector<char>& bytes) {
-		if (bytes.size() != sizeof(float)) {
-			throw std::invalid_argument("Invalid byte size for float conversion");
-		}
-
-		unsigned int int_rep;
-		std::memcpy(&int_rep, bytes.data(), sizeof(float));
-		int_rep = ntohl(int_rep);  // Convert from network byte order
-
-		float num;
-		std::memcpy(&num, &int_rep, sizeof(float));
-		return num;
-	}
-
-
 	/**
 	 * send data with udp.
 	 *
@@ -189,6 +218,8 @@ public:
 
 	int sendData(const std::vector<char>& buffer, sockaddr_in udp_addr_in);
 
+	int sendData(const char* buffer, int len, sockaddr_in udp_addr_in);
+
 	int broadcastData(const std::vector<char>& buffer);
 
 	int getSessionId();
@@ -201,24 +232,29 @@ public:
 	 */
 	void udpListener();
 
+	/**
+	 * classifies a single received datagram. acks are recorded immediately,
+	 * everything else is queued for requestHandler.
+	 *
+	 * \param senderAddr
+	 * \param buf
+	 * \param len
+	 */
+	void onDatagram(const sockaddr_in& senderAddr, const char* buf, int len);
+
 	void requestHandler();
 
 	int init();
 
 	void cleanup();
 
+	void printStats();
+
 
 	static constexpr int KEEP_ALIVE_TIMEOUT_MS = 5000;
 	void keepAliveChecker();
 
 
-	static std::deque<std::future<void>> threadpool;
-	static std::mutex threadpool_mutex;
-
-	static void threadpoolManager();
-
-
-
 	static std::string getCurrentDateString();
 };
 
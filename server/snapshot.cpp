@@ -0,0 +1,358 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file snapshot.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the delta compressed ALL_ENTITIES snapshots
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "snapshot.h"
+#include "quantize.h"
+
+SnapshotEncoder& SnapshotEncoder::getInstance() {
+	static SnapshotEncoder instance;
+	return instance;
+}
+
+void SnapshotEncoder::capture(const Game::Data& data, State& curr) {
+	curr.tick = data.tick;
+	curr.spaceships.clear();
+	curr.bullets.clear();
+	curr.asteroids.clear();
+
+	const Game::Spaceships& spaceships = data.spaceships;
+	const size_t num_spaceships = std::min(spaceships.size(), (size_t)MAX_SPACESHIPS);
+	for (size_t i{}; i < num_spaceships; i++) {
+		Entity e;
+		e.id = spaceships.id[i];
+		e.sid = spaceships.sid[i];
+		e.x = spaceships.x[i];
+		e.y = spaceships.y[i];
+		e.rotation = spaceships.rotation[i];
+		e.input_seq = spaceships.input_seq[i];
+		e.lives = (uint8_t)spaceships.lives_left[i];
+		e.score = (uint8_t)spaceships.score[i];
+		curr.spaceships.push_back(e);
+	}
+	const Game::Bullets& bullets = data.bullets;
+	const size_t num_bullets = std::min(bullets.size(), (size_t)MAX_BULLETS);
+	for (size_t i{}; i < num_bullets; i++) {
+		Entity e;
+		e.id = bullets.id[i];
+		e.sid = bullets.sid[i];
+		e.x = bullets.x[i];
+		e.y = bullets.y[i];
+		curr.bullets.push_back(e);
+	}
+	const Game::Asteroids& asteroids = data.asteroids;
+	const size_t num_asteroids = std::min(asteroids.size(), (size_t)MAX_ASTEROIDS);
+	for (size_t i{}; i < num_asteroids; i++) {
+		Entity e;
+		e.id = asteroids.id[i];
+		e.x = asteroids.x[i];
+		e.y = asteroids.y[i];
+		e.radius = asteroids.radius[i];
+		curr.asteroids.push_back(e);
+	}
+
+	getInstance().num_left_out += spaceships.size() + bullets.size() + asteroids.size() - num_spaceships - num_bullets - num_asteroids;
+}
+
+bool SnapshotEncoder::encode(const State& curr, std::vector<char>& buf) {
+	// delta against what every player has acked
+	sids.clear();
+	for (const Entity& e : curr.spaceships) {
+		sids.push_back(e.sid);
+	}
+
+	const uint32_t seq = next_seq++;
+	const State* baseline = findBaseline(sids, seq);
+	State& view = ring[seq % RING_SIZE];
+	view.seq = seq;
+
+	// the frame's buffer keeps MAX_PACKET_SIZE of capacity, neither resize allocates
+	buf.resize(Server::MAX_PACKET_SIZE);
+	BufferWriter w(buf.data(), buf.size());
+	w.u8(Server::ALL_ENTITIES);
+	w.u32(seq);
+	w.u32(baseline ? baseline->seq : 0);
+	w.u32(curr.tick);
+
+	if (baseline == nullptr) {
+		w.u8((uint8_t)curr.spaceships.size());
+		for (const Entity& e : curr.spaceships) writeFull(w, SPACESHIPS, e);
+
+		w.u8((uint8_t)curr.bullets.size());
+		for (const Entity& e : curr.bullets) writeFull(w, BULLETS, e);
+
+		w.u8((uint8_t)curr.asteroids.size());
+		for (const Entity& e : curr.asteroids) writeFull(w, ASTEROIDS, e);
+
+		view.spaceships.clear();
+		view.bullets.clear();
+		view.asteroids.clear();
+		for (const Entity& e : curr.spaceships) view.spaceships.push_back(quantized(e));
+		for (const Entity& e : curr.bullets) view.bullets.push_back(quantized(e));
+		for (const Entity& e : curr.asteroids) view.asteroids.push_back(quantized(e));
+		num_full++;
+	}
+	else {
+		writeDelta(w, SPACESHIPS, baseline->spaceships, curr.spaceships, view.spaceships);
+		writeDelta(w, BULLETS, baseline->bullets, curr.bullets, view.bullets);
+		writeDelta(w, ASTEROIDS, baseline->asteroids, curr.asteroids, view.asteroids);
+		num_delta++;
+	}
+
+	// capture's caps keep every snapshot within a packet, see the static_asserts in snapshot.h.
+	// should they not, nothing is sent and no client can ack this seq, so it is never a baseline
+	if (!w.ok()) {
+		buf.clear();
+		num_overflowed++;
+		return false;
+	}
+	buf.resize(w.size());
+
+	// cmd - num spaceships - spaceships - num bullets - bullets - num asteroids - asteroids, all floats
+	bytes_uncompressed += 4 + 15 * curr.spaceships.size() + 9 * curr.bullets.size() + 12 * curr.asteroids.size();
+	bytes_sent += buf.size();
+	return true;
+}
+
+const SnapshotEncoder::State* SnapshotEncoder::findBaseline(const std::vector<SESSION_ID>& sids, uint32_t seq) {
+	if (sids.empty()) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(acked_mutex);
+
+	// the slot of seq - RING_SIZE is about to be overwritten
+	for (uint32_t s = seq - 1; s > 0 && seq - s < RING_SIZE; s--) {
+		const State& candidate = ring[s % RING_SIZE];
+		if (candidate.seq != s) {
+			continue;
+		}
+
+		const bool ackedByAll = std::all_of(sids.begin(), sids.end(), [this, s](SESSION_ID sid) {
+			auto it = acked.find(sid);
+			return it != acked.end() && it->second[s % RING_SIZE] == s;
+		});
+		if (ackedByAll) {
+			return &candidate;
+		}
+	}
+	return nullptr;
+}
+
+void SnapshotEncoder::writeFull(BufferWriter& w, CATEGORY category, const Entity& e) {
+	w.u32(e.id);									// entity id (4 bytes)
+
+	switch (category) {
+	case SPACESHIPS:
+		w.u8(e.sid & 0xff);							// spaceship sid
+		w.u16(Quantize::posX(e.x));					// pos x (2 bytes)
+		w.u16(Quantize::posY(e.y));					// pos y (2 bytes)
+		w.u16(Quantize::rotation(e.rotation));		// rotation (2 bytes)
+		w.u8(e.lives);								// lives left (1 byte)
+		w.u8(e.score);								// score (1 byte)
+		w.u32(e.input_seq);							// newest input applied (4 bytes)
+		break;
+	case BULLETS:
+		w.u8(e.sid & 0xff);							// bullet sid
+		w.u16(Quantize::posX(e.x));					// pos x (2 bytes)
+		w.u16(Quantize::posY(e.y));					// pos y (2 bytes)
+		break;
+	case ASTEROIDS:
+		w.u16(Quantize::posX(e.x));					// pos x (2 bytes)
+		w.u16(Quantize::posY(e.y));					// pos y (2 bytes)
+		w.u8(Quantize::radius(e.radius));			// asteroid radius (1 byte)
+		break;
+	}
+}
+
+SnapshotEncoder::Entity SnapshotEncoder::quantized(const Entity& e) {
+	Entity q = e;
+	q.x = Quantize::posX(Quantize::posX(e.x));
+	q.y = Quantize::posY(Quantize::posY(e.y));
+	q.rotation = Quantize::rotation(Quantize::rotation(e.rotation));
+	q.radius = Quantize::radius(Quantize::radius(e.radius));
+	return q;
+}
+
+void SnapshotEncoder::writeDelta(BufferWriter& w, CATEGORY category, const std::vector<Entity>& baseline, const std::vector<Entity>& entities, std::vector<Entity>& view) {
+	// match current entities to their index in the baseline
+	baseline_index.clear();
+	for (int i{}; i < (int)baseline.size(); i++) {
+		baseline_index[baseline[i].id] = i;
+	}
+
+	matched.assign(baseline.size(), -1);
+	added.clear();
+	for (int i{}; i < (int)entities.size(); i++) {
+		auto it = baseline_index.find(entities[i].id);
+		if (it != baseline_index.end() && matched[it->second] < 0) {
+			matched[it->second] = i;
+		}
+		else {
+			added.push_back(i);
+		}
+	}
+
+	// removed - 1 bit per baseline entity
+	for (int first{}; first < (int)baseline.size(); first += 8) {
+		uint8_t bits{};
+		for (int i = first; i < first + 8 && i < (int)baseline.size(); i++) {
+			if (matched[i] < 0) {
+				bits |= 1 << (i - first);
+			}
+		}
+		w.u8(bits);
+	}
+
+	// changed - baseline index, field mask, fields. entities that are not mentioned are unchanged.
+	// the count is patched in once the records are written
+	const size_t num_changed_pos = w.size();
+	w.u8(0);
+	int num_changed{};
+
+	view.clear();
+	for (int i{}; i < (int)baseline.size(); i++) {
+		if (matched[i] < 0) {
+			continue;
+		}
+		const Entity& b = baseline[i];
+		const Entity& e = entities[matched[i]];
+
+		Entity v = b;
+		uint8_t mask{};
+
+		const long qx = std::lround((e.x - b.x) * POS_DELTA_SCALE);
+		const long qy = std::lround((e.y - b.y) * POS_DELTA_SCALE);
+		const bool small_pos = std::abs(qx) <= INT8_MAX && std::abs(qy) <= INT8_MAX;
+
+		if (small_pos) {
+			// must match the client reconstruction exactly
+			mask |= FIELD_SMALL_POS;
+			if (qx) {
+				mask |= FIELD_X;
+				v.x = b.x + (float)qx / POS_DELTA_SCALE;
+			}
+			if (qy) {
+				mask |= FIELD_Y;
+				v.y = b.y + (float)qy / POS_DELTA_SCALE;
+			}
+		}
+		else {
+			if (Quantize::posX(e.x) != Quantize::posX(b.x)) {
+				mask |= FIELD_X;
+				v.x = Quantize::posX(Quantize::posX(e.x));
+			}
+			if (Quantize::posY(e.y) != Quantize::posY(b.y)) {
+				mask |= FIELD_Y;
+				v.y = Quantize::posY(Quantize::posY(e.y));
+			}
+		}
+
+		if (category == SPACESHIPS) {
+			if (Quantize::rotation(e.rotation) != Quantize::rotation(b.rotation)) {
+				mask |= FIELD_ROTATION;
+				v.rotation = Quantize::rotation(Quantize::rotation(e.rotation));
+			}
+			if (e.lives != b.lives) {
+				mask |= FIELD_LIVES;
+				v.lives = e.lives;
+			}
+			if (e.score != b.score) {
+				mask |= FIELD_SCORE;
+				v.score = e.score;
+			}
+			if (e.input_seq != b.input_seq) {
+				mask |= FIELD_INPUT_SEQ;
+				v.input_seq = e.input_seq;
+			}
+		}
+
+		view.push_back(v);
+
+		if ((mask & ~FIELD_SMALL_POS) == 0) {
+			continue;
+		}
+		num_changed++;
+
+		w.u8((uint8_t)i);				// baseline index (1 byte)
+		w.u8(mask);						// field mask (1 byte)
+		if (mask & FIELD_X) {
+			if (small_pos) w.u8((uint8_t)(int8_t)qx);		// pos x delta (1 byte)
+			else w.u16(Quantize::posX(e.x));				// pos x (2 bytes)
+		}
+		if (mask & FIELD_Y) {
+			if (small_pos) w.u8((uint8_t)(int8_t)qy);		// pos y delta (1 byte)
+			else w.u16(Quantize::posY(e.y));				// pos y (2 bytes)
+		}
+		if (mask & FIELD_ROTATION) {
+			w.u16(Quantize::rotation(e.rotation));			// rotation (2 bytes)
+		}
+		if (mask & FIELD_LIVES) {
+			w.u8(v.lives);					// lives left (1 byte)
+		}
+		if (mask & FIELD_SCORE) {
+			w.u8(v.score);					// score (1 byte)
+		}
+		if (mask & FIELD_INPUT_SEQ) {
+			w.u32(v.input_seq);				// newest input applied (4 bytes)
+		}
+	}
+	w.patchU8(num_changed_pos, (uint8_t)num_changed);
+
+	// added - full entities, appended after the remaining baseline entities
+	w.u8((uint8_t)added.size());
+	for (int i : added) {
+		writeFull(w, category, entities[i]);
+		view.push_back(quantized(entities[i]));
+	}
+}
+
+void SnapshotEncoder::ack(SESSION_ID sid, uint32_t seq) {
+	std::lock_guard<std::mutex> lock(acked_mutex);
+
+	auto it = acked.find(sid);
+	if (it == acked.end()) {
+		it = acked.emplace(sid, std::array<uint32_t, RING_SIZE>{}).first;
+	}
+	it->second[seq % RING_SIZE] = seq;
+}
+
+void SnapshotEncoder::removeSession(SESSION_ID sid) {
+	std::lock_guard<std::mutex> lock(acked_mutex);
+	acked.erase(sid);
+}
+
+void SnapshotEncoder::printStats(std::ostream& os) {
+	const uint64_t full = num_full;
+	const uint64_t delta = num_delta;
+	const uint64_t sent = bytes_sent;
+	const uint64_t uncompressed = bytes_uncompressed;
+
+	os << "snapshots: " << full + delta << " sent (" << full << " full, " << delta << " delta), "
+		<< sent << " bytes vs " << uncompressed << " bytes uncompressed";
+	if (sent) {
+		os << " (" << std::fixed << std::setprecision(2) << (double)uncompressed / sent << "x)" << std::defaultfloat;
+	}
+	os << std::endl;
+
+	const uint64_t left_out = num_left_out;
+	if (left_out) {
+		os << "snapshot entities left out over a cap: " << left_out << std::endl;
+	}
+	const uint64_t overflowed = num_overflowed;
+	if (overflowed) {
+		os << "snapshots not sent, over a packet: " << overflowed << std::endl;
+	}
+}
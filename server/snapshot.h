@@ -0,0 +1,191 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file snapshot.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the delta compressed ALL_ENTITIES snapshots
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include "game.h"
+#include "buffer.h"
+
+#include <array>
+
+/**
+ * longest one category of a snapshot can encode to: a delta with every baseline entity
+ * removed and every entity added, 2 counts, the removed bits and the full records.
+ *
+ * \param count entities in the baseline and in the snapshot
+ * \param record bytes of a full entity record
+ * \return
+ */
+constexpr int maxSnapshotCategorySize(int count, int record) {
+	return 2 + (count + 7) / 8 + count * record;
+}
+
+/**
+ * encodes ALL_ENTITIES snapshots.
+ *
+ * every snapshot has a sequence number that clients ack with ACK_ALL_ENTITIES.
+ * ALL_ENTITIES is a single broadcast, so a snapshot is delta encoded against the newest
+ * earlier snapshot that every playing session has acked. when there is none, e.g. a session
+ * just joined or lost too many snapshots, a full snapshot is sent.
+ *
+ * positions, rotations and radii are fixed point (quantize.h). the ring keeps snapshots as
+ * the client reconstructs them, so server and client always diff against the same values
+ * and rounding errors do not accumulate.
+ */
+class SnapshotEncoder {
+private:
+	SnapshotEncoder() = default;
+
+public:
+	static SnapshotEncoder& getInstance();
+
+	static constexpr int RING_SIZE = 32;			// snapshots kept as baselines, ~1s at Server::SNAPSHOT_RATE
+	static constexpr float POS_DELTA_SCALE = 16.f;	// position deltas are sent in 1/16 px
+
+	// bytes of a full entity record. a changed record of a delta is never longer
+	static constexpr int HEADER_SIZE = 13;			// cmd, seq, baseline seq, tick
+	static constexpr int SPACESHIP_SIZE = 18;
+	static constexpr int BULLET_SIZE = 9;
+	static constexpr int ASTEROID_SIZE = 9;
+
+	// entities sent per category, capture leaves out the rest so any snapshot fits one packet.
+	// bullets have no cap in the game and get whatever the others leave, less their 2 counts and a
+	// rounded up removed byte
+	static constexpr int MAX_SPACESHIPS = Game::MAX_PLAYERS;
+	static constexpr int MAX_ASTEROIDS = Game::MAX_ASTEROIDS;
+	static constexpr int MAX_BULLETS = (Server::MAX_PACKET_SIZE - HEADER_SIZE
+		- maxSnapshotCategorySize(MAX_SPACESHIPS, SPACESHIP_SIZE) - maxSnapshotCategorySize(MAX_ASTEROIDS, ASTEROID_SIZE) - 3) * 8 / (BULLET_SIZE * 8 + 1);
+
+	static_assert(HEADER_SIZE + maxSnapshotCategorySize(MAX_SPACESHIPS, SPACESHIP_SIZE) + maxSnapshotCategorySize(MAX_BULLETS, BULLET_SIZE)
+		+ maxSnapshotCategorySize(MAX_ASTEROIDS, ASTEROID_SIZE) <= Server::MAX_PACKET_SIZE, "a snapshot may not fit a packet");
+	static_assert(MAX_BULLETS >= 8 * Game::MAX_PLAYERS, "too few bullets fit a packet");
+	static_assert(MAX_SPACESHIPS <= UINT8_MAX && MAX_BULLETS <= UINT8_MAX && MAX_ASTEROIDS <= UINT8_MAX,
+		"counts and baseline indices are sent as a byte");
+
+	// field mask of a changed entity in a delta snapshot
+	enum FIELDS : uint8_t {
+		FIELD_X = 1 << 0,
+		FIELD_Y = 1 << 1,
+		FIELD_SMALL_POS = 1 << 2,	// x and y are int8 deltas instead of 16 bit positions, most entities move less than 8px between snapshots
+		FIELD_ROTATION = 1 << 3,
+		FIELD_LIVES = 1 << 4,
+		FIELD_SCORE = 1 << 5,
+		FIELD_INPUT_SEQ = 1 << 6,
+	};
+
+	// snapshot as seen by the clients. entities are matched across snapshots by id
+	struct Entity {
+		uint32_t id{};			// Game::EntityIds
+		SESSION_ID sid{};
+		float x{}, y{};
+		float rotation{};		// spaceships
+		float radius{};			// asteroids
+		uint8_t lives{}, score{};
+		uint32_t input_seq{};	// spaceships, newest SELF_SPACESHIP applied
+	};
+
+	struct State {
+		uint32_t seq{};
+		uint32_t tick{};		// Game::Data::tick it was captured at, clients interpolate on it
+		std::vector<Entity> spaceships;
+		std::vector<Entity> bullets;
+		std::vector<Entity> asteroids;
+	};
+
+	/**
+	 * copies the entities out of the game state, cheap enough to do while the tick holds Game::data_mutex.
+	 * at most MAX_SPACESHIPS, MAX_BULLETS and MAX_ASTEROIDS, entities stored past a cap are left out.
+	 *
+	 * \param data
+	 * \param state
+	 */
+	static void capture(const Game::Data& data, State& state);
+
+	/**
+	 * builds the ALL_ENTITIES payload of a captured state. only called by the encoder stage.
+	 *
+	 * \param state from capture
+	 * \param buf cmd - snapshot seq - baseline seq (0 for a full snapshot) - tick - entities. reused, needs
+	 *            Server::MAX_PACKET_SIZE of capacity so encoding does not allocate
+	 * \return false if the snapshot did not fit a packet, buf is empty and there is nothing to send
+	 */
+	bool encode(const State& state, std::vector<char>& buf);
+
+	/**
+	 * records that a session has reconstructed a snapshot.
+	 *
+	 * \param sid
+	 * \param seq
+	 */
+	void ack(SESSION_ID sid, uint32_t seq);
+
+	void removeSession(SESSION_ID sid);
+
+	void printStats(std::ostream& os);
+
+private:
+	enum CATEGORY {
+		SPACESHIPS,
+		BULLETS,
+		ASTEROIDS,
+	};
+
+	/**
+	 * newest snapshot before seq that is still in the ring and acked by every session in sids.
+	 *
+	 * \param sids
+	 * \param seq
+	 * \return nullptr if there is none
+	 */
+	const State* findBaseline(const std::vector<SESSION_ID>& sids, uint32_t seq);
+
+	void writeFull(BufferWriter& w, CATEGORY category, const Entity& e);
+
+	/**
+	 * e as the client decodes it from a full record.
+	 *
+	 * \param e
+	 * \return
+	 */
+	static Entity quantized(const Entity& e);
+
+	void writeDelta(BufferWriter& w, CATEGORY category, const std::vector<Entity>& baseline, const std::vector<Entity>& entities, std::vector<Entity>& view);
+
+	uint32_t next_seq = 1;
+	std::array<State, RING_SIZE> ring{};		// indexed by seq % RING_SIZE, only touched by the encoder stage
+
+	std::mutex acked_mutex;
+	std::unordered_map<SESSION_ID, std::array<uint32_t, RING_SIZE>> acked;	// acked seq per ring slot of each session
+
+	// reused between encodes
+	std::vector<SESSION_ID> sids;
+	std::unordered_map<uint32_t, int> baseline_index;
+	std::vector<int> matched;		// current entity of each baseline entity, -1 if removed
+	std::vector<int> added;			// current entities without a baseline entity
+
+	// stats
+	std::atomic<uint64_t> num_full{};
+	std::atomic<uint64_t> num_delta{};
+	std::atomic<uint64_t> num_left_out{};			// entities over a per category cap, not sent
+	std::atomic<uint64_t> num_overflowed{};			// snapshots that did not fit a packet despite the caps
+	std::atomic<uint64_t> bytes_sent{};
+	std::atomic<uint64_t> bytes_uncompressed{};		// size of the same snapshots as full snapshots of 32 bit floats
+};
+
+#endif // __SNAPSHOT_H__
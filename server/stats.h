@@ -0,0 +1,150 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file stats.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the latency histogram used by the server stats
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * lock free histogram of durations in microseconds.
+ * values are bucketed by power of two, each power split into SUB_BUCKETS linear buckets,
+ * so a reported percentile is at most 1/SUB_BUCKETS above the real value.
+ * record() may be called from any thread.
+ */
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BUCKET_BITS = 3;
+	static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static constexpr int NUM_GROUPS = 32;		// up to ~2^34 us
+	static constexpr int NUM_BUCKETS = NUM_GROUPS * SUB_BUCKETS;
+
+	void record(uint64_t us) {
+		buckets[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+		total.fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t prev_max = max_us.load(std::memory_order_relaxed);
+		while (us > prev_max && !max_us.compare_exchange_weak(prev_max, us, std::memory_order_relaxed)) {}
+	}
+
+	uint64_t count() const { return total.load(std::memory_order_relaxed); }
+	uint64_t max() const { return max_us.load(std::memory_order_relaxed); }
+
+	/**
+	 * \param p percentile in [0, 100]
+	 * \return upper bound of the bucket holding the p-th percentile
+	 */
+	uint64_t percentile(double p) const {
+		const uint64_t n = count();
+		if (n == 0) {
+			return 0;
+		}
+
+		uint64_t rank = (uint64_t)(p / 100.0 * (double)n + 0.5);
+		if (rank < 1) rank = 1;
+		if (rank > n) rank = n;
+
+		uint64_t seen{};
+		for (int i{}; i < NUM_BUCKETS; i++) {
+			seen += buckets[i].load(std::memory_order_relaxed);
+			if (seen >= rank) {
+				const uint64_t upper = bucketUpperBound(i);
+				return upper < max() ? upper : max();
+			}
+		}
+		return max();
+	}
+
+	void reset() {
+		for (auto& b : buckets) {
+			b.store(0, std::memory_order_relaxed);
+		}
+		total.store(0, std::memory_order_relaxed);
+		max_us.store(0, std::memory_order_relaxed);
+	}
+
+	void print(std::ostream& os, const char* name) const {
+		os << name << ": n=" << count()
+			<< " p50=" << percentile(50) << "us"
+			<< " p90=" << percentile(90) << "us"
+			<< " p99=" << percentile(99) << "us"
+			<< " p99.9=" << percentile(99.9) << "us"
+			<< " max=" << max() << "us" << std::endl;
+	}
+
+private:
+	static int bucketIndex(uint64_t v) {
+		if (v < SUB_BUCKETS) {
+			return (int)v;
+		}
+
+		int msb{};
+		for (uint64_t x = v; x > 1; x >>= 1) {
+			msb++;
+		}
+
+		const int shift = msb - SUB_BUCKET_BITS;
+		const int idx = (shift + 1) * SUB_BUCKETS + (int)((v >> shift) - SUB_BUCKETS);
+		return idx < NUM_BUCKETS ? idx : NUM_BUCKETS - 1;
+	}
+
+	static uint64_t bucketUpperBound(int idx) {
+		if (idx < SUB_BUCKETS) {
+			return (uint64_t)idx;
+		}
+
+		const int shift = idx / SUB_BUCKETS - 1;
+		const uint64_t lower = (uint64_t)(SUB_BUCKETS + idx % SUB_BUCKETS) << shift;
+		return lower + ((uint64_t)1 << shift) - 1;
+	}
+
+	std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+	std::atomic<uint64_t> total{};
+	std::atomic<uint64_t> max_us{};
+};
+
+/**
+ * times a benchmark body. fn runs reps times in each of a few batches and the fastest batch
+ * counts, so a batch slowed down by the scheduler or a cold cache does not.
+ *
+ * \param reps calls per batch, enough for a batch to take a few ms
+ * \param fn
+ * \return microseconds per call in the fastest batch
+ */
+template <typename Fn>
+double bestOf(int reps, Fn&& fn) {
+	using Clock = std::chrono::steady_clock;
+	constexpr int BATCHES = 5;
+
+	Clock::duration best = Clock::duration::max();
+	for (int batch{}; batch < BATCHES; batch++) {
+		const auto start = Clock::now();
+		for (int r{}; r < reps; r++) {
+			fn();
+		}
+		const auto elapsed = Clock::now() - start;
+		best = elapsed < best ? elapsed : best;
+	}
+	return std::chrono::duration<double, std::micro>(best).count() / reps;
+}
+
+#endif // __STATS_H__
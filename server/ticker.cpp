@@ -0,0 +1,123 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file ticker.cpp
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file implements the tick scheduler of the game loop
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#include "ticker.h"
+
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#endif
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace {
+	uint64_t toMicroseconds(TickScheduler::Clock::duration d) {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+	}
+}
+
+TickScheduler::TickScheduler(Clock::duration period) : period{ period } {
+#ifdef _WIN32
+	// windows 10 1803 and later, wakes within ~0.5ms without changing the timer period of the whole system
+	timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!timer) {
+		raised_resolution = timeBeginPeriod(1) == TIMERR_NOERROR;
+	}
+#endif
+}
+
+TickScheduler::~TickScheduler() {
+#ifdef _WIN32
+	if (timer) {
+		CloseHandle(timer);
+	}
+	if (raised_resolution) {
+		timeEndPeriod(1);
+	}
+#endif
+}
+
+void TickScheduler::sleepUntil(Clock::time_point t) {
+#ifdef __linux__
+	// steady_clock is CLOCK_MONOTONIC, an absolute wake up is not pushed back by signals
+	const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+	timespec ts{};
+	ts.tv_sec = (time_t)(ns / 1000000000);
+	ts.tv_nsec = (long)(ns % 1000000000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#elif defined(_WIN32)
+	const auto now = Clock::now();
+	if (timer && t > now) {
+		// relative due time in negative 100ns units
+		LARGE_INTEGER due{};
+		due.QuadPart = -(LONGLONG)std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10000000>>>(t - now).count();
+		if (SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE)) {
+			WaitForSingleObject(timer, INFINITE);
+			return;
+		}
+	}
+	std::this_thread::sleep_until(t);
+#else
+	std::this_thread::sleep_until(t);
+#endif
+}
+
+void TickScheduler::start() {
+	deadline = Clock::now() + period;
+}
+
+int TickScheduler::wait() {
+	auto now = Clock::now();
+
+	if (now >= deadline) {
+		// the caller is late, this tick starts right away
+		overruns.record(toMicroseconds(now - deadline));
+	}
+	else {
+		if (deadline - now > SPIN_MARGIN) {
+			sleepUntil(deadline - SPIN_MARGIN);
+		}
+
+		// spin the rest, yielding so another thread on this core is not starved
+		while ((now = Clock::now()) < deadline) {
+			std::this_thread::yield();
+		}
+		jitter.record(toMicroseconds(now - deadline));
+	}
+
+	// step to the first deadline after now
+	const int due = (int)((now - deadline) / period) + 1;
+	deadline += due * period;
+	return due;
+}
+
+void TickScheduler::printStats(std::ostream& os) const {
+	jitter.print(os, "tick start jitter");
+	overruns.print(os, "tick overruns");
+}
@@ -0,0 +1,90 @@
+/* Start Header
+*****************************************************************/
+/*!
+\file ticker.h
+\author Poh Jing Seng, 2301363
+\par jingseng.poh\@digipen.edu
+\date 1 Apr 2025
+\brief
+This file declares the tick scheduler of the game loop
+Copyright (C) 2025 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the
+prior written consent of DigiPen Institute of Technology is prohibited.
+*/
+/* End Header
+*******************************************************************/
+
+#pragma once
+
+#ifndef __TICKER_H__
+#define __TICKER_H__
+
+#include "stats.h"
+
+#include <chrono>
+#include <ostream>
+
+/**
+ * wakes a loop up on absolute deadlines, start + n * period.
+ *
+ * waiting on deadlines instead of sleeping a period after each tick means sleep overshoot
+ * and tick work never add up into drift. most of the wait is slept, the last SPIN_MARGIN
+ * is spun so the wake up does not depend on the os timer granularity.
+ *
+ * on windows Sleep wakes on the system timer interrupt, 15.6ms by default, longer than a tick.
+ * the scheduler sleeps on a high resolution waitable timer instead, or raises the timer
+ * resolution to 1ms with timeBeginPeriod while it lives where that timer is not available.
+ *
+ * only used by one thread, the histograms may be printed from any thread.
+ */
+class TickScheduler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+#ifdef __linux__
+	// clock_nanosleep usually wakes within the 50us timer slack
+	static constexpr auto SPIN_MARGIN = std::chrono::microseconds(200);
+#else
+	// a high resolution timer or a 1ms timer period still wakes up to ~1ms late
+	static constexpr auto SPIN_MARGIN = std::chrono::microseconds(2000);
+#endif
+
+	explicit TickScheduler(Clock::duration period);
+	~TickScheduler();
+
+	TickScheduler(const TickScheduler&) = delete;
+	TickScheduler& operator=(const TickScheduler&) = delete;
+
+	// first deadline is one period from now
+	void start();
+
+	/**
+	 * blocks until the next deadline. deadlines missed while the caller was busy are skipped,
+	 * the next one stays on the start + n * period grid.
+	 *
+	 * \return number of deadlines that passed since the last call, 1 unless the caller overran
+	 */
+	int wait();
+
+	/**
+	 * \param os
+	 */
+	void printStats(std::ostream& os) const;
+
+private:
+	// coarse sleep, may wake up a little late
+	void sleepUntil(Clock::time_point t);
+
+	const Clock::duration period;
+	Clock::time_point deadline;
+
+	LatencyHistogram jitter;		// wake up minus deadline, for ticks that were waited for
+	LatencyHistogram overruns;		// how far past the deadline the caller came back
+
+#ifdef _WIN32
+	void* timer{};					// high resolution waitable timer, null if not supported
+	bool raised_resolution{};		// timeBeginPeriod(1) is in effect
+#endif
+};
+
+#endif // __TICKER_H__